@@ -1,6 +1,9 @@
 #pragma once
 #include <JuceHeader.h>
 #include <chrono>
+#include "oversampling/ConvolutionFilter.h"
+#include "dsp/Perlin.h"
+#include "Interpolation.h"
 
 namespace benchmark
 {
@@ -83,6 +86,354 @@ namespace benchmark
 		file.appendText("\navg: " + String(avg));
 	}
 
+	/*
+	* logs the time per block of oversampling::ConvolutionFilter<double>
+	* next to a plain ring buffer convolution with a wrap branch per tap (the former implementation)
+	*/
+	inline void convolutionFilter(int numIterations = 1024, int numChannels = 2, int blockSize = 512 * 4)
+	{
+		using ConvolutionFilter = oversampling::ConvolutionFilter<double>;
+		using IR = oversampling::ImpulseResponse<double>;
+		
+		AtomicDuration duration;
+		juce::AudioBuffer<double> buffer(numChannels, blockSize);
+		juce::Random rand;
+		for (auto ch = 0; ch < numChannels; ++ch)
+			for (auto s = 0; s < blockSize; ++s)
+				buffer.setSample(ch, s, rand.nextDouble() * 2. - 1.);
+		auto samples = buffer.getArrayOfWritePointers();
+
+		const IR ir(oversampling::makeSincFilter2(176400., 22050., 44100., false));
+		ConvolutionFilter filter(176400., 22050., 44100., false);
+		std::vector<std::vector<double>> rings(numChannels, std::vector<double>(ir.size(), 0.));
+		std::vector<int> wIdxs(numChannels, 0);
+
+		const auto processRing = [&]()
+		{
+			const auto irSize = static_cast<int>(ir.size());
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto& ring = rings[ch];
+				auto& wIdx = wIdxs[ch];
+				auto smpls = samples[ch];
+				for (auto s = 0; s < blockSize; ++s)
+				{
+					++wIdx;
+					if (wIdx == irSize)
+						wIdx = 0;
+					ring[wIdx] = smpls[s];
+					auto y = 0.;
+					auto rIdx = wIdx;
+					for (auto i = 0; i < irSize; ++i)
+					{
+						y += ring[rIdx] * ir[i];
+						--rIdx;
+						if (rIdx == -1)
+							rIdx = irSize - 1;
+					}
+					smpls[s] = y;
+				}
+			}
+		};
+
+		const String name(String(__TIME__).replaceCharacter(':', '_') + "_convolution.txt");
+
+		const auto desktop = SpecialLoc::userDesktopDirectory;
+		const auto folder = File::getSpecialLocation(desktop).getChildFile("Benchmark2");
+		if (!folder.exists())
+			folder.createDirectory();
+		const auto file = folder.getChildFile(name);
+		if (file.exists())
+			file.deleteFile();
+		file.create();
+
+		long long sumRing = 0, sumFilter = 0;
+		for (auto i = 0; i < numIterations; ++i)
+		{
+			{
+				Measure measure(duration);
+				processRing();
+			}
+			sumRing += std::chrono::duration_cast<Nano>(duration.load()).count();
+			{
+				Measure measure(duration);
+				filter.processBlockDown(samples, numChannels, blockSize);
+			}
+			sumFilter += std::chrono::duration_cast<Nano>(duration.load()).count();
+		}
+
+		const auto avgRing = static_cast<double>(sumRing) / static_cast<double>(numIterations);
+		const auto avgFilter = static_cast<double>(sumFilter) / static_cast<double>(numIterations);
+		file.appendText("taps: " + String(static_cast<int>(ir.size())));
+		file.appendText("\nring avg (ns): " + String(avgRing));
+		file.appendText("\nsimd avg (ns): " + String(avgFilter));
+		file.appendText("\nspeedup: " + String(avgRing / avgFilter));
+	}
+
+	/*
+	* logs the time per block of perlin::Perlin2 with a fixed and with a smoothed octaves parameter
+	* next to a per sample sum of the octaves through the interpolation function pointers (the former implementation)
+	*/
+	inline void perlin(int numIterations = 1024, int numChannels = 2, int blockSize = 512, double octaves = 5.5)
+	{
+		using Perlin2 = perlin::Perlin2;
+		using Shape = perlin::Shape;
+		using PlayHeadPos = perlin::PlayHeadPos;
+
+		AtomicDuration duration;
+		juce::AudioBuffer<double> buffer(numChannels, blockSize);
+		auto samples = buffer.getArrayOfWritePointers();
+
+		const auto fs = 44100.;
+		const auto rateHz = 4.;
+		Perlin2 perlin2;
+		perlin2.prepare(fs, blockSize, 0);
+		PlayHeadPos playHeadPos;
+
+		const perlin::InterpolationFunc funcs[] = { &perlin::getInterpolatedNN, &perlin::getInterpolatedLerp, &perlin::getInterpolatedSpline };
+		auto phase = 0.;
+		const auto processPerSample = [&](Shape shape)
+		{
+			const auto func = funcs[static_cast<int>(shape)];
+			const auto noise = perlin2.noise.data();
+			const auto gains = perlin2.gainBuffer.data();
+			const auto inc = rateHz / fs;
+			for (auto s = 0; s < blockSize; ++s)
+			{
+				const auto octFloor = std::floor(octaves);
+				auto smpl = 0.;
+				auto gain = 0.;
+				for (auto o = 0; o < octFloor; ++o)
+				{
+					smpl += func(noise, perlin::getPhaseOctaved(phase, o)) * gains[o];
+					gain += gains[o];
+				}
+				const auto o = static_cast<int>(octFloor);
+				const auto octFrac = octaves - octFloor;
+				smpl += octFrac * func(noise, perlin::getPhaseOctaved(phase, o)) * gains[o];
+				gain += octFrac * gains[o];
+				samples[0][s] = smpl / std::sqrt(gain);
+				phase += inc;
+			}
+			for (auto ch = 1; ch < numChannels; ++ch)
+				buffer.copyFrom(ch, 0, samples[0], blockSize);
+		};
+
+		const String name(String(__TIME__).replaceCharacter(':', '_') + "_perlin.txt");
+
+		const auto desktop = SpecialLoc::userDesktopDirectory;
+		const auto folder = File::getSpecialLocation(desktop).getChildFile("Benchmark2");
+		if (!folder.exists())
+			folder.createDirectory();
+		const auto file = folder.getChildFile(name);
+		if (file.exists())
+			file.deleteFile();
+		file.create();
+
+		file.appendText("octaves: " + String(octaves));
+		for (auto sh = 0; sh < static_cast<int>(Shape::NumShapes); ++sh)
+		{
+			const auto shape = static_cast<Shape>(sh);
+			long long sumPerSample = 0, sumFixed = 0, sumSmoothed = 0;
+			for (auto i = 0; i < numIterations; ++i)
+			{
+				{
+					Measure measure(duration);
+					processPerSample(shape);
+				}
+				sumPerSample += std::chrono::duration_cast<Nano>(duration.load()).count();
+				{
+					Measure measure(duration);
+					perlin2(samples, numChannels, blockSize, playHeadPos, rateHz, 1., octaves, 0., 0., 0., shape, false);
+				}
+				sumFixed += std::chrono::duration_cast<Nano>(duration.load()).count();
+			}
+			for (auto i = 0; i < numIterations; ++i)
+			{
+				// alternating octaves keep the parameter smoothing busy
+				const auto oct = i % 2 == 0 ? octaves : octaves - 1.;
+				Measure measure(duration);
+				perlin2(samples, numChannels, blockSize, playHeadPos, rateHz, 1., oct, 0., 0., 0., shape, false);
+				sumSmoothed += std::chrono::duration_cast<Nano>(duration.load()).count();
+			}
+
+			const auto numIterationsD = static_cast<double>(numIterations);
+			const auto avgPerSample = static_cast<double>(sumPerSample) / numIterationsD;
+			const auto avgFixed = static_cast<double>(sumFixed) / numIterationsD;
+			const auto avgSmoothed = static_cast<double>(sumSmoothed) / numIterationsD;
+			file.appendText("\n\nshape: " + String(sh));
+			file.appendText("\nper sample avg (ns): " + String(avgPerSample));
+			file.appendText("\nfixed octaves avg (ns): " + String(avgFixed));
+			file.appendText("\nsmoothed octaves avg (ns): " + String(avgSmoothed));
+			file.appendText("\nspeedup: " + String(avgPerSample / avgFixed));
+		}
+	}
+
+	/*
+	* report, rand, numIterations, blockSize, bufferSize, tolerance
+	* compares the block versions of interpolation::lerp and interpolation::cubicHermiteSpline with the scalar ones
+	* and logs the largest deviation and the time per block of both. returns false if a deviation exceeds the tolerance
+	*/
+	template<typename Float>
+	inline bool checkInterpolation(String& report, juce::Random& rand, int numIterations, int blockSize,
+		int bufferSize, double tolerance)
+	{
+		// guard samples on both sides, so read heads may be negative
+		static constexpr int Guard = 4;
+		std::vector<Float> data(bufferSize + 2 * Guard);
+		for (auto& d : data)
+			d = static_cast<Float>(rand.nextDouble() * 2. - 1.);
+		const auto buffer = data.data() + Guard;
+		std::vector<double> readHeads(blockSize);
+		std::vector<Float> scalar(blockSize), block(blockSize);
+
+		AtomicDuration duration;
+		auto maxDevLerp = 0.;
+		auto maxDevSpline = 0.;
+		long long sumScalar = 0, sumBlock = 0;
+		const auto maxHead = static_cast<double>(bufferSize - 3);
+		for (auto i = 0; i < numIterations; ++i)
+		{
+			// the first blocks are shorter than a few simd lanes, the others end with a random remainder
+			const auto numSamples = i < 8 ? i + 1 : 1 + rand.nextInt(blockSize);
+			for (auto s = 0; s < numSamples; ++s)
+				readHeads[s] = rand.nextDouble() * (maxHead + 2.) - 2.;
+			// negative heads with fractions, integer heads and a head just below an integer
+			const double edges[] = { -.25, -1.75, -2., -1e-9, 0., 1., 3. - 1e-9, maxHead - 1e-9 };
+			for (auto e = 0; e < 8 && e < numSamples; ++e)
+				readHeads[(e * 5) % numSamples] = edges[e];
+
+			{
+				Measure measure(duration);
+				for (auto s = 0; s < numSamples; ++s)
+					scalar[s] = interpolation::lerp(buffer, readHeads[s]);
+			}
+			sumScalar += std::chrono::duration_cast<Nano>(duration.load()).count();
+			{
+				Measure measure(duration);
+				interpolation::lerp(block.data(), buffer, readHeads.data(), numSamples);
+			}
+			sumBlock += std::chrono::duration_cast<Nano>(duration.load()).count();
+			for (auto s = 0; s < numSamples; ++s)
+				maxDevLerp = std::max(maxDevLerp, static_cast<double>(std::abs(block[s] - scalar[s])));
+
+			// the spline reads one sample behind the head, like the vibrato does
+			{
+				Measure measure(duration);
+				for (auto s = 0; s < numSamples; ++s)
+					scalar[s] = interpolation::cubicHermiteSpline(buffer - 1, readHeads[s]);
+			}
+			sumScalar += std::chrono::duration_cast<Nano>(duration.load()).count();
+			{
+				Measure measure(duration);
+				interpolation::cubicHermiteSpline(block.data(), buffer - 1, readHeads.data(), numSamples);
+			}
+			sumBlock += std::chrono::duration_cast<Nano>(duration.load()).count();
+			for (auto s = 0; s < numSamples; ++s)
+				maxDevSpline = std::max(maxDevSpline, static_cast<double>(std::abs(block[s] - scalar[s])));
+		}
+
+		const auto numIterationsD = static_cast<double>(numIterations);
+		report << "\n\n" << (sizeof(Float) == sizeof(float) ? "float" : "double");
+		report << "\nlerp max deviation: " << maxDevLerp;
+		report << "\nspline max deviation: " << maxDevSpline;
+		report << "\nscalar avg (ns): " << static_cast<double>(sumScalar) / numIterationsD;
+		report << "\nblock avg (ns): " << static_cast<double>(sumBlock) / numIterationsD;
+		return maxDevLerp <= tolerance && maxDevSpline <= tolerance;
+	}
+
+	/*
+	* report, rand, name, tableF, tableD, numIterations, bufferSize, tolerance.
+	* reads the float table with float and double read heads against the double table.
+	* heads just below an integer would round their phase up to a row past the end of the table
+	*/
+	template<int NumTaps>
+	inline bool checkPolyphaseTable(String& report, juce::Random& rand, const String& name,
+		const interpolation::PolyphaseTable<float, NumTaps>& tableF,
+		const interpolation::PolyphaseTable<double, NumTaps>& tableD,
+		int numIterations, int bufferSize, double tolerance)
+	{
+		using Table = interpolation::PolyphaseTable<float, NumTaps>;
+		std::vector<float> dataF(bufferSize);
+		std::vector<double> dataD(bufferSize);
+		for (auto i = 0; i < bufferSize; ++i)
+		{
+			dataF[i] = static_cast<float>(rand.nextDouble() * 2. - 1.);
+			dataD[i] = static_cast<double>(dataF[i]);
+		}
+
+		// the kernel reads Behind samples before and Ahead samples after the head
+		const auto minHead = Table::Behind + 1;
+		const auto numHeads = bufferSize - Table::Ahead - 2 - minHead;
+		auto maxDev = 0.;
+		for (auto i = 0; i < numIterations; ++i)
+		{
+			const auto integer = static_cast<float>(minHead + rand.nextInt(numHeads));
+			const float headsF[] =
+			{
+				std::nextafter(integer, 0.f),
+				integer,
+				integer + static_cast<float>(rand.nextDouble())
+			};
+			for (const auto headF : headsF)
+			{
+				const auto headD = static_cast<double>(headF);
+				const auto y = tableD(dataD.data(), headD);
+				const auto yF = static_cast<double>(tableF(dataF.data(), headF));
+				const auto yD = static_cast<double>(tableF(dataF.data(), headD));
+				maxDev = std::max(maxDev, std::max(std::abs(yF - y), std::abs(yD - y)));
+			}
+			// a head just below an integer in double
+			const auto headD = static_cast<double>(integer) - 1e-12;
+			const auto y = tableD(dataD.data(), headD);
+			maxDev = std::max(maxDev, std::abs(static_cast<double>(tableF(dataF.data(), headD)) - y));
+		}
+
+		report << "\n" << name << " (float) max deviation: " << maxDev;
+		return maxDev <= tolerance;
+	}
+
+	/*
+	* checks the block interpolators (gathers with AVX2) against the scalar ones
+	* for float and double, with random and negative read heads and blocks that leave a remainder after the lanes,
+	* and the float polyphase tables against the double ones. logToFile writes the report to the desktop
+	*/
+	inline bool interpolationBlock(int numIterations = 1024, int blockSize = 512, int bufferSize = 1 << 12,
+		bool logToFile = true)
+	{
+		juce::Random rand;
+		String report("avx2: " + String(NEL_SIMD_AVX2));
+		auto ok = checkInterpolation<float>(report, rand, numIterations, blockSize, bufferSize, 1e-5);
+		ok = checkInterpolation<double>(report, rand, numIterations, blockSize, bufferSize, 1e-12) && ok;
+
+		report << "\n";
+		using namespace interpolation;
+		ok = checkPolyphaseTable(report, rand, "sinc8", sinc8<float>, sinc8<double>, numIterations, bufferSize, 1e-5) && ok;
+		ok = checkPolyphaseTable(report, rand, "sinc16", sinc16<float>, sinc16<double>, numIterations, bufferSize, 1e-5) && ok;
+		ok = checkPolyphaseTable(report, rand, "lagrange4", lagrange4<float>, lagrange4<double>, numIterations, bufferSize, 1e-5) && ok;
+		ok = checkPolyphaseTable(report, rand, "lagrange6", lagrange6<float>, lagrange6<double>, numIterations, bufferSize, 1e-5) && ok;
+		report << (ok ? "\n\npassed" : "\n\nFAILED");
+
+		if (logToFile)
+		{
+			const String name(String(__TIME__).replaceCharacter(':', '_') + "_interpolation.txt");
+
+			const auto desktop = SpecialLoc::userDesktopDirectory;
+			const auto folder = File::getSpecialLocation(desktop).getChildFile("Benchmark2");
+			if (!folder.exists())
+				folder.createDirectory();
+			const auto file = folder.getChildFile(name);
+			if (file.exists())
+				file.deleteFile();
+			file.create();
+			file.appendText(report);
+		}
+		else
+			DBG(report);
+		jassert(ok);
+		return ok;
+	}
+
 	struct ProcessBlock :
 		public Timer
 	{
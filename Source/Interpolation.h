@@ -1,6 +1,8 @@
 #pragma once
 #include <cmath>
 #include <math.h>
+#include <array>
+#include "SIMD.h"
 
 namespace interpolation
 {
@@ -51,34 +53,51 @@ namespace interpolation
 		return sum;
 	}
 
-	template<typename Float>
-	inline Float lerp(const Float* buffer, const Float x, const int size)
+	/* the read head may be more precise than the buffer (e.g. float buffer, double read head) */
+	template<typename Float, typename Pos = Float>
+	inline Float lerp(const Float* buffer, const Pos x, const int size)
 	{
 		const auto iFloor = std::floor(x);
 		const auto i0 = static_cast<int>(iFloor);
 		auto i1 = i0 + 1;
 		if (i1 >= size)
 			i1 -= size;
-		const auto xFrac = x - iFloor;
+		const auto xFrac = static_cast<Float>(x - iFloor);
 		const auto x0 = buffer[i0];
 		const auto x1 = buffer[i1];
 		return x0 + xFrac * (x1 - x0);
 	}
 
-	template<typename Float>
-	inline Float lerp(const Float* buffer, const Float x)
+	/* no wrapping, buffer[floor(x) + 1] must be readable (e.g. guard samples) */
+	template<typename Float, typename Pos = Float>
+	inline Float lerp(const Float* buffer, const Pos x)
 	{
 		const auto iFloor = std::floor(x);
 		const auto i0 = static_cast<int>(iFloor);
 		const auto i1 = i0 + 1;
-		const auto xFrac = x - iFloor;
+		const auto xFrac = static_cast<Float>(x - iFloor);
 		const auto x0 = buffer[i0];
 		const auto x1 = buffer[i1];
 		return x0 + xFrac * (x1 - x0);
 	}
 
-	template<typename Float>
-	inline Float cubicHermiteSpline(const Float* buffer, const Float readHead, const int size) noexcept
+	/* buffer0, buffer1, x. reads two buffers at the same position, the fraction is computed once */
+	template<typename Float, typename Pos = Float>
+	inline std::array<Float, 2> lerp(const Float* buffer0, const Float* buffer1, const Pos x)
+	{
+		const auto iFloor = std::floor(x);
+		const auto i0 = static_cast<int>(iFloor);
+		const auto i1 = i0 + 1;
+		const auto xFrac = static_cast<Float>(x - iFloor);
+		return
+		{
+			buffer0[i0] + xFrac * (buffer0[i1] - buffer0[i0]),
+			buffer1[i0] + xFrac * (buffer1[i1] - buffer1[i0])
+		};
+	}
+
+	template<typename Float, typename Pos = Float>
+	inline Float cubicHermiteSpline(const Float* buffer, const Pos readHead, const int size) noexcept
 	{
 		const auto iFloor = std::floor(readHead);
 		auto i1 = static_cast<int>(iFloor);
@@ -93,7 +112,7 @@ namespace interpolation
 		if (i0 < 0)
 			i0 += size;
 
-		const auto t = readHead - iFloor;
+		const auto t = static_cast<Float>(readHead - iFloor);
 		const auto v0 = buffer[i0];
 		const auto v1 = buffer[i1];
 		const auto v2 = buffer[i2];
@@ -107,8 +126,9 @@ namespace interpolation
 		return ((c3 * t + c2) * t + c1) * t + c0;
 	}
 	
-	template<typename Float>
-	inline Float cubicHermiteSpline(const Float* buffer, const Float readHead) noexcept
+	/* no wrapping, interpolates between buffer[floor(readHead) + 1] and buffer[floor(readHead) + 2] */
+	template<typename Float, typename Pos = Float>
+	inline Float cubicHermiteSpline(const Float* buffer, const Pos readHead) noexcept
 	{
 		const auto iFloor = std::floor(readHead);
 		const auto i0 = static_cast<int>(iFloor);
@@ -116,7 +136,7 @@ namespace interpolation
 		const auto i2 = i0 + 2;
 		const auto i3 = i0 + 3;
 
-		const auto t = readHead - iFloor;
+		const auto t = static_cast<Float>(readHead - iFloor);
 		const auto v0 = buffer[i0];
 		const auto v1 = buffer[i1];
 		const auto v2 = buffer[i2];
@@ -129,6 +149,28 @@ namespace interpolation
 
 		return ((c3 * t + c2) * t + c1) * t + c0;
 	}
+
+	/* buffer0, buffer1, readHead. reads two buffers at the same position, see above */
+	template<typename Float, typename Pos = Float>
+	inline std::array<Float, 2> cubicHermiteSpline(const Float* buffer0, const Float* buffer1, const Pos readHead) noexcept
+	{
+		const auto iFloor = std::floor(readHead);
+		const auto i0 = static_cast<int>(iFloor);
+		const auto t = static_cast<Float>(readHead - iFloor);
+
+		std::array<Float, 2> y;
+		const Float* buffers[] = { buffer0, buffer1 };
+		for (auto ch = 0; ch < 2; ++ch)
+		{
+			const auto v = &buffers[ch][i0];
+			const auto c0 = v[1];
+			const auto c1 = static_cast<Float>(.5) * (v[2] - v[0]);
+			const auto c2 = v[0] - static_cast<Float>(2.5) * v[1] + static_cast<Float>(2.) * v[2] - static_cast<Float>(.5) * v[3];
+			const auto c3 = static_cast<Float>(1.5) * (v[1] - v[2]) + static_cast<Float>(.5) * (v[3] - v[0]);
+			y[ch] = ((c3 * t + c2) * t + c1) * t + c0;
+		}
+		return y;
+	}
 	
 	inline float lagrange(const float* buffer, const float readHead, const int size, const int N)
 	{
@@ -147,6 +189,268 @@ namespace interpolation
 		}
 		return yp;
 	}
+
+	/*
+	* block versions of lerp and cubicHermiteSpline (no wrapping):
+	* dest[s] gets buffer interpolated at x[s], with the same rounding as the scalar versions.
+	* with AVX2 the samples around 4 read positions are fetched by gathers at once,
+	* the generic templates and the remainder of a block run the scalar code.
+	*/
+
+	/* dest, buffer, x, numSamples */
+	template<typename Float, typename Pos>
+	inline void lerp(Float* dest, const Float* buffer, const Pos* x, int numSamples) noexcept
+	{
+		for (auto s = 0; s < numSamples; ++s)
+			dest[s] = lerp(buffer, x[s]);
+	}
+
+	/* dest, buffer, readHeads, numSamples */
+	template<typename Float, typename Pos>
+	inline void cubicHermiteSpline(Float* dest, const Float* buffer, const Pos* readHeads, int numSamples) noexcept
+	{
+		for (auto s = 0; s < numSamples; ++s)
+			dest[s] = cubicHermiteSpline(buffer, readHeads[s]);
+	}
+
+#if NEL_SIMD_AVX2
+	inline void lerp(double* dest, const double* buffer, const double* x, int numSamples) noexcept
+	{
+		auto s = 0;
+		for (; s + 4 <= numSamples; s += 4)
+		{
+			const auto xv = _mm256_loadu_pd(x + s);
+			const auto iFloor = _mm256_floor_pd(xv);
+			const auto i0 = _mm256_cvttpd_epi32(iFloor);
+			const auto xFrac = _mm256_sub_pd(xv, iFloor);
+			const auto x0 = _mm256_i32gather_pd(buffer, i0, 8);
+			const auto x1 = _mm256_i32gather_pd(buffer + 1, i0, 8);
+			_mm256_storeu_pd(dest + s, _mm256_add_pd(x0, _mm256_mul_pd(xFrac, _mm256_sub_pd(x1, x0))));
+		}
+		for (; s < numSamples; ++s)
+			dest[s] = lerp(buffer, x[s]);
+	}
+
+	inline void lerp(float* dest, const float* buffer, const double* x, int numSamples) noexcept
+	{
+		auto s = 0;
+		for (; s + 4 <= numSamples; s += 4)
+		{
+			const auto xv = _mm256_loadu_pd(x + s);
+			const auto iFloor = _mm256_floor_pd(xv);
+			const auto i0 = _mm256_cvttpd_epi32(iFloor);
+			const auto xFrac = _mm256_cvtpd_ps(_mm256_sub_pd(xv, iFloor));
+			const auto x0 = _mm_i32gather_ps(buffer, i0, 4);
+			const auto x1 = _mm_i32gather_ps(buffer + 1, i0, 4);
+			_mm_storeu_ps(dest + s, _mm_add_ps(x0, _mm_mul_ps(xFrac, _mm_sub_ps(x1, x0))));
+		}
+		for (; s < numSamples; ++s)
+			dest[s] = lerp(buffer, x[s]);
+	}
+
+	inline void cubicHermiteSpline(double* dest, const double* buffer, const double* readHeads, int numSamples) noexcept
+	{
+		const auto half = _mm256_set1_pd(.5);
+		const auto oneHalf = _mm256_set1_pd(1.5);
+		const auto two = _mm256_set1_pd(2.);
+		const auto twoHalf = _mm256_set1_pd(2.5);
+
+		auto s = 0;
+		for (; s + 4 <= numSamples; s += 4)
+		{
+			const auto xv = _mm256_loadu_pd(readHeads + s);
+			const auto iFloor = _mm256_floor_pd(xv);
+			const auto i0 = _mm256_cvttpd_epi32(iFloor);
+			const auto t = _mm256_sub_pd(xv, iFloor);
+			const auto v0 = _mm256_i32gather_pd(buffer, i0, 8);
+			const auto v1 = _mm256_i32gather_pd(buffer + 1, i0, 8);
+			const auto v2 = _mm256_i32gather_pd(buffer + 2, i0, 8);
+			const auto v3 = _mm256_i32gather_pd(buffer + 3, i0, 8);
+
+			const auto c1 = _mm256_mul_pd(half, _mm256_sub_pd(v2, v0));
+			const auto c2 = _mm256_sub_pd(_mm256_add_pd(_mm256_sub_pd(v0, _mm256_mul_pd(twoHalf, v1)), _mm256_mul_pd(two, v2)), _mm256_mul_pd(half, v3));
+			const auto c3 = _mm256_add_pd(_mm256_mul_pd(oneHalf, _mm256_sub_pd(v1, v2)), _mm256_mul_pd(half, _mm256_sub_pd(v3, v0)));
+
+			auto y = _mm256_add_pd(_mm256_mul_pd(c3, t), c2);
+			y = _mm256_add_pd(_mm256_mul_pd(y, t), c1);
+			y = _mm256_add_pd(_mm256_mul_pd(y, t), v1);
+			_mm256_storeu_pd(dest + s, y);
+		}
+		for (; s < numSamples; ++s)
+			dest[s] = cubicHermiteSpline(buffer, readHeads[s]);
+	}
+
+	inline void cubicHermiteSpline(float* dest, const float* buffer, const double* readHeads, int numSamples) noexcept
+	{
+		const auto half = _mm_set1_ps(.5f);
+		const auto oneHalf = _mm_set1_ps(1.5f);
+		const auto two = _mm_set1_ps(2.f);
+		const auto twoHalf = _mm_set1_ps(2.5f);
+
+		auto s = 0;
+		for (; s + 4 <= numSamples; s += 4)
+		{
+			const auto xv = _mm256_loadu_pd(readHeads + s);
+			const auto iFloor = _mm256_floor_pd(xv);
+			const auto i0 = _mm256_cvttpd_epi32(iFloor);
+			const auto t = _mm256_cvtpd_ps(_mm256_sub_pd(xv, iFloor));
+			const auto v0 = _mm_i32gather_ps(buffer, i0, 4);
+			const auto v1 = _mm_i32gather_ps(buffer + 1, i0, 4);
+			const auto v2 = _mm_i32gather_ps(buffer + 2, i0, 4);
+			const auto v3 = _mm_i32gather_ps(buffer + 3, i0, 4);
+
+			const auto c1 = _mm_mul_ps(half, _mm_sub_ps(v2, v0));
+			const auto c2 = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(v0, _mm_mul_ps(twoHalf, v1)), _mm_mul_ps(two, v2)), _mm_mul_ps(half, v3));
+			const auto c3 = _mm_add_ps(_mm_mul_ps(oneHalf, _mm_sub_ps(v1, v2)), _mm_mul_ps(half, _mm_sub_ps(v3, v0)));
+
+			auto y = _mm_add_ps(_mm_mul_ps(c3, t), c2);
+			y = _mm_add_ps(_mm_mul_ps(y, t), c1);
+			y = _mm_add_ps(_mm_mul_ps(y, t), v1);
+			_mm_storeu_ps(dest + s, y);
+		}
+		for (; s < numSamples; ++s)
+			dest[s] = cubicHermiteSpline(buffer, readHeads[s]);
+	}
+#endif
+
+	/*
+	* fir interpolator with one row of NumTaps coefficients per fractional phase.
+	* the rows are computed once, reading costs one table lerp and one dot product per sample.
+	* odd tap counts centre the kernel on the nearest sample, even ones between the two nearest.
+	* reads buffer[floor(x) - Behind] to buffer[floor(x) + Ahead] without wrapping.
+	*/
+	template<typename Float, int NumTaps>
+	struct PolyphaseTable
+	{
+		static constexpr int NumPhases = 256;
+		static constexpr int Shift2 = NumTaps % 2; // 2 * shift of the read head
+		static constexpr int Behind = (NumTaps - 1) / 2;
+		static constexpr int Ahead = NumTaps / 2 + Shift2;
+
+		/* kernel(pos (read head relative to the first tap), k (tap), NumTaps) -> weight of tap k */
+		template<typename Kernel>
+		PolyphaseTable(Kernel&& kernel) :
+			coefs(),
+			deltas()
+		{
+			std::array<double, NumTaps * (NumPhases + 1)> rows;
+			for (auto p = 0; p <= NumPhases; ++p)
+			{
+				// position of the read head relative to the first tap
+				const auto u = static_cast<double>(p) / static_cast<double>(NumPhases);
+				const auto pos = u - static_cast<double>(Shift2) * .5 + static_cast<double>(Behind);
+				auto row = &rows[p * NumTaps];
+				auto sum = 0.;
+				for (auto k = 0; k < NumTaps; ++k)
+				{
+					row[k] = kernel(pos, k, NumTaps);
+					sum += row[k];
+				}
+				// unity gain at dc for every phase
+				for (auto k = 0; k < NumTaps; ++k)
+					row[k] /= sum;
+			}
+			for (auto p = 0; p < NumPhases; ++p)
+				for (auto k = 0; k < NumTaps; ++k)
+				{
+					const auto i = p * NumTaps + k;
+					coefs[i] = static_cast<Float>(rows[i]);
+					deltas[i] = static_cast<Float>(rows[i + NumTaps] - rows[i]);
+				}
+		}
+
+		/* buffer, x */
+		template<typename Pos>
+		Float operator()(const Float* buffer, const Pos x) const noexcept
+		{
+			const auto xShifted = x + static_cast<Pos>(Shift2) * static_cast<Pos>(.5);
+			const auto iFloor = std::floor(xShifted);
+			// in Pos, because a fraction just below 1 would round up to 1 in float and pick a row past the end
+			const auto phase = (xShifted - iFloor) * static_cast<Pos>(NumPhases);
+			const auto phaseFloor = std::floor(phase);
+			const auto f = static_cast<Float>(phase - phaseFloor);
+			const auto row = static_cast<int>(phaseFloor) * NumTaps;
+			const auto c = &coefs[row];
+			const auto d = &deltas[row];
+			const auto b = &buffer[static_cast<int>(iFloor) - Behind];
+
+			auto y = static_cast<Float>(0);
+			for (auto k = 0; k < NumTaps; ++k)
+				y += (c[k] + f * d[k]) * b[k];
+			return y;
+		}
+
+		/* buffer0, buffer1, x. the row is interpolated once and shared by both dot products */
+		template<typename Pos>
+		std::array<Float, 2> operator()(const Float* buffer0, const Float* buffer1, const Pos x) const noexcept
+		{
+			const auto xShifted = x + static_cast<Pos>(Shift2) * static_cast<Pos>(.5);
+			const auto iFloor = std::floor(xShifted);
+			// in Pos, because a fraction just below 1 would round up to 1 in float and pick a row past the end
+			const auto phase = (xShifted - iFloor) * static_cast<Pos>(NumPhases);
+			const auto phaseFloor = std::floor(phase);
+			const auto f = static_cast<Float>(phase - phaseFloor);
+			const auto row = static_cast<int>(phaseFloor) * NumTaps;
+			const auto c = &coefs[row];
+			const auto d = &deltas[row];
+			const auto i = static_cast<int>(iFloor) - Behind;
+			const auto b0 = &buffer0[i];
+			const auto b1 = &buffer1[i];
+
+			std::array<Float, NumTaps> w;
+			for (auto k = 0; k < NumTaps; ++k)
+				w[k] = c[k] + f * d[k];
+			auto y0 = static_cast<Float>(0);
+			auto y1 = static_cast<Float>(0);
+			for (auto k = 0; k < NumTaps; ++k)
+			{
+				y0 += w[k] * b0[k];
+				y1 += w[k] * b1[k];
+			}
+			return { y0, y1 };
+		}
+
+	protected:
+		std::array<Float, NumTaps * NumPhases> coefs, deltas;
+	};
+
+	namespace kernel
+	{
+		/* pos (read head relative to the first tap), k (tap), numTaps. sinc with a blackman window over all taps */
+		inline double windowedSinc(double pos, int k, int numTaps) noexcept
+		{
+			static constexpr double PiD = 3.1415926535897932384626433832795;
+			const auto d = pos - static_cast<double>(k);
+			const auto r = d / (static_cast<double>(numTaps) * .5);
+			if (r <= -1. || r >= 1.)
+				return 0.;
+			const auto w = .42 + .5 * std::cos(PiD * r) + .08 * std::cos(2. * PiD * r);
+			if (d == 0.)
+				return w;
+			const auto dPi = d * PiD;
+			return std::sin(dPi) / dPi * w;
+		}
+
+		/* pos (read head relative to the first tap), k (tap), numTaps. lagrange basis polynomial of the order numTaps - 1 */
+		inline double lagrange(double pos, int k, int numTaps) noexcept
+		{
+			auto y = 1.;
+			for (auto j = 0; j < numTaps; ++j)
+				if (j != k)
+					y *= (pos - static_cast<double>(j)) / static_cast<double>(k - j);
+			return y;
+		}
+	}
+
+	/* the tables are built once when the plugin is loaded */
+	template<typename Float>
+	inline const PolyphaseTable<Float, 8> sinc8(kernel::windowedSinc);
+	template<typename Float>
+	inline const PolyphaseTable<Float, 16> sinc16(kernel::windowedSinc);
+	template<typename Float>
+	inline const PolyphaseTable<Float, 5> lagrange4(kernel::lagrange);
+	template<typename Float>
+	inline const PolyphaseTable<Float, 7> lagrange6(kernel::lagrange);
 }
 
 /*
@@ -30,7 +30,7 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
     layoutMainParams
     (
         { 8, 13 },
-        { 2, 5, 5, 5, 5, 2 }
+        { 2, 5, 5, 5, 5, 2, 2 }
     ),
     layoutBottomBar
     (
@@ -39,7 +39,7 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
     ),
     layoutTopBar
     (
-        { 2, 2, 2, 2, 2, 13 },
+        { 2, 2, 2, 2, 2, 2, 11 },
         { 1 }
     ),
     utils(*this, p.appProperties.getUserSettings(), p),
@@ -80,8 +80,12 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
     macro3Dragger(utils, 3, modulatables),
     
     paramRandomizer(utils, modulatables),
-	hq(utils, "HQ", "Strong vibrato causes less 'grainy' sidelobes with 4x oversampling.", modSys6::PID::HQ, modulatables, gui::ParameterType::Switch),
+	hq(utils, "HQ", "Strong vibrato causes less 'grainy' sidelobes with oversampling.", modSys6::PID::HQ, modulatables, gui::ParameterType::Switch),
 	lookahead(utils, "Lookahead", "Lookahead aligns the average position of the vibrato with the dry signal.", modSys6::PID::Lookahead, modulatables, gui::ParameterType::Switch),
+	osFactor(utils, "OS", "The oversampling factor of HQ. Auto picks the lowest factor that lifts the sample rate to 176khz or more. 4x FIR is the legacy convolution chain.", modSys6::PID::OversamplingFactor, modulatables, gui::ParameterType::Knob),
+	osLowLatency(utils, "OSMode", "Linear phase oversampling keeps the phase intact, low latency oversampling (allpass iir, or minimum phase fir at 4x FIR) only adds a few samples of latency.", modSys6::PID::OversamplingLowLatency, modulatables, gui::ParameterType::Switch),
+	voices(utils, "Voices", "The number of read heads (voices). More than one voice turns the vibrato into a chorus/ensemble.", modSys6::PID::Voices, modulatables, gui::ParameterType::Knob),
+	voicesSpread(utils, "Spread", "Spreads the voices across the buffer and takes modulation depth from them in exchange.", modSys6::PID::VoicesSpread, modulatables, gui::ParameterType::Knob),
     popUp(utils),
     enterValue(utils),
 
@@ -135,6 +139,10 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
     addAndMakeVisible(paramRandomizer);
     addAndMakeVisible(hq);
 	addAndMakeVisible(lookahead);
+	addAndMakeVisible(osFactor);
+	addAndMakeVisible(osLowLatency);
+	addAndMakeVisible(voices);
+	addAndMakeVisible(voicesSpread);
 #if DebugMenuExists
     addAndMakeVisible(menuButton);
 #endif
@@ -307,6 +315,9 @@ void Nel19AudioProcessorEditor::resized()
     layoutMainParams.place(damp, 0, 4, 1, 1);
     layoutMainParams.place(feedback, 1, 4, 1, 1);
     layoutMainParams.place(stereoConfig, 0, 5, 1, 1, 0.f, true);
+    layoutMainParams.place(osFactor, 1, 5, 1, 1, 0.f, true);
+    layoutMainParams.place(voices, 0, 6, 1, 1, 0.f, true);
+    layoutMainParams.place(voicesSpread, 1, 6, 1, 1, 0.f, true);
     
     layoutTopBar.place(paramRandomizer, 1, 0, 1, 1, 0.f, true);
 #if DebugMenuExists
@@ -317,7 +328,8 @@ void Nel19AudioProcessorEditor::resized()
 #endif
     layoutTopBar.place(hq,              3, 0, 1, 1, 0.f, true);
 	layoutTopBar.place(lookahead,       4, 0, 1, 1, 0.f, true);
-    layoutTopBar.place(nelLabel,        5, 0, 1, 1, thicc * 4.f);
+	layoutTopBar.place(osLowLatency,    5, 0, 1, 1, 0.f, true);
+    layoutTopBar.place(nelLabel,        6, 0, 1, 1, thicc * 4.f);
     {
         auto area = layoutMainParams(0, 0, 2, 1);
         area.setY(layoutTopBar.getY(0));
@@ -51,7 +51,7 @@ protected:
     gui::ModDragger macro0Dragger, macro1Dragger, macro2Dragger, macro3Dragger;
 
     gui::ParamtrRandomizer paramRandomizer;
-    gui::Paramtr hq, lookahead;
+    gui::Paramtr hq, lookahead, osFactor, osLowLatency, voices, voicesSpread;
 
     gui::PopUp popUp;
     gui::EnterValueComp enterValue;
@@ -22,27 +22,36 @@ Nel19AudioProcessor::Nel19AudioProcessor()
      :
     AudioProcessor(makeBusesProps()),
     Timer(),
-    sidechain(),
     appProperties(),
     standalonePlayHead(),
-    audioBufferD(),
-    dryWet(),
     params(*this),
-    oversampling(),
+    engineF(),
+    engineD(),
     modulators(),
     modsBuffer(),
+    modsBufferUp(),
+    depthBufferUp(),
+    modsBuffer1x(),
+    depthBuffer1x(),
+    modsUpsampler(),
+    depthUpsampler(),
     modType
     {
         vibrato::ModType::LFO,
         vibrato::ModType::Perlin
     },
-    vibrat(),
     visualizerValues{ 0., 0. },
     depth(1.), modsMix(0.)
 #endif
 {
     appProperties.setStorageParameters(makeOptions());
 
+#if JUCE_DEBUG
+    // the block interpolators and polyphase tables against their references, once per session
+    static const auto interpolationChecked = benchmark::interpolationBlock(64, 512, 1 << 12, false);
+    juce::ignoreUnused(interpolationChecked);
+#endif
+
     startTimerHz(4);
 }
 
@@ -125,52 +134,80 @@ void Nel19AudioProcessor::changeProgramName(int, const String&)
 
 void Nel19AudioProcessor::prepareToPlay(double sampleRate, int maxBufferSize)
 {
+    // only the engine of the host's precision is prepared. juce prepares again when the precision changes
+    if (isUsingDoublePrecision())
+        prepareToPlayT<double>(sampleRate, maxBufferSize);
+    else
+        prepareToPlayT<float>(sampleRate, maxBufferSize);
+}
+
+template<typename Float>
+void Nel19AudioProcessor::prepareToPlayT(double sampleRate, int maxBufferSize)
+{
+    auto& engine = getEngine<Float>();
     standalonePlayHead.prepare(sampleRate);
-    
-    audioBufferD.setSize(4, maxBufferSize, false, true, false);
 
     using PID = modSys6::PID;
 
     //const auto delaySizeMs = 13.;
-    const auto delaySizeMs = static_cast<double>(params(PID::BufferSize).getValSumDenorm());
-    const auto delaySizeD = std::round(sampleRate * delaySizeMs / 1000.);
-	auto delaySize = static_cast<int>(delaySizeD);
-    if (delaySize % 2 != 0)
-		delaySize += 1;
+    const auto& bufferSizeParam = params(PID::BufferSize);
+    const auto delaySize = getDelaySize(sampleRate, static_cast<double>(bufferSizeParam.getValSumDenorm()));
+    // the delay lines are allocated for the largest buffer size, so it can change without allocating
+    const auto maxDelaySize = getDelaySize(sampleRate, static_cast<double>(bufferSizeParam.range.end));
     const auto delaySizeHalf = delaySize / 2;
-    
-    dryWet.prepare(sampleRate, maxBufferSize, delaySizeHalf);
 
     const auto lookaheadEnabled = params(PID::Lookahead).getValueSum() > .5f;
 
 	auto latency = delaySizeHalf * (lookaheadEnabled ? 1 : 0);
     
-    bool osEnabled = false;
+    auto osOrder = 1;
 #if OversamplingEnabled && !DebugModsBuffer
-	osEnabled = params(PID::HQ).getValueSum() > .5f;
-    oversampling.prepareToPlay(sampleRate, maxBufferSize, osEnabled);
+	osOrder = getOversamplingOrder(sampleRate);
+    const auto osFilterType = getOversamplingFilterType();
+    engine.oversampling.prepareToPlay(sampleRate, maxBufferSize, osOrder, osFilterType);
+    const auto& oversampling = engine.oversampling;
+    osOrder = oversampling.getOrder();
 
     const auto sampleRateUpD = oversampling.getSampleRateUpsampled();
     const auto blockSizeUp = oversampling.getBlockSizeUp();
-    latency += oversampling.getLatency();
+    // the latency of the hq path is reported even while hq is off, so toggling it doesn't move the signal
+    const auto osLatency = oversampling.getLatency();
+    const auto hqEnabled = params(PID::HQ).getValueSum() > .5f;
 #else
     const auto sampleRateUpD = sampleRate;
 	const auto blockSizeUp = maxBufferSize;
+    const auto osLatency = 0;
+    const auto hqEnabled = false;
 #endif
-    depth.prepare(sampleRate, blockSizeUp, 24.);
-	modsMix.prepare(sampleRate, blockSizeUp, 24.);
-
-    modsBuffer.setSize(2, blockSizeUp, false, true, false);
+    latency += osLatency;
+    // the dry signal is delayed by the latency of the wet signal, oversampling included
+    engine.dryWet.prepare(sampleRate, maxBufferSize, latency);
+
+    // modulators run at the base rate and only the mixed modsBuffer is upsampled for the delay's read heads.
+    // audio rate modulators are upsampled band-limited (see ControlUpsampler)
+    depth.prepare(sampleRate, maxBufferSize, 24.);
+	modsMix.prepare(sampleRate, maxBufferSize, 24.);
+
+    modsBuffer.setSize(2, maxBufferSize, false, true, false);
+    modsBufferUp.setSize(2, blockSizeUp, false, true, false);
+    depthBufferUp.setSize(1, blockSizeUp, false, true, false);
+    modsBuffer1x.setSize(2, maxBufferSize, false, true, false);
+    depthBuffer1x.setSize(1, maxBufferSize, false, true, false);
+    modsUpsampler.prepare(osOrder, maxBufferSize);
+    depthUpsampler.prepare(osOrder, maxBufferSize, static_cast<double>(params(PID::Depth).getValueSum()));
     
     for (auto m = 0; m < NumActiveMods; ++m)
-        modulators[m].prepare(sampleRateUpD, blockSizeUp, latency, osEnabled ? 4 : 1);
+        modulators[m].prepare(sampleRate, maxBufferSize, latency, 1);
         
-    vibrat.prepare
-    (
-        sampleRateUpD,
-        blockSizeUp,
-        delaySize * (osEnabled ? 4 : 1)
-    );
+    engine.vibrat.prepare(sampleRateUpD, blockSizeUp, delaySize * osOrder, maxDelaySize * osOrder);
+    engine.vibrat1x.prepare(sampleRate, maxBufferSize, delaySize, maxDelaySize);
+    if (osLatency != 0)
+        engine.delay1x.prepare(maxBufferSize, osLatency);
+    engine.buffer1x.setSize(2, maxBufferSize, false, true, false);
+    // a whole delay buffer of warm-up, so the path that fades in doesn't play back silence
+    engine.pathSwitch.prepare(sampleRate, 20., delaySize + osLatency, maxBufferSize, hqEnabled ? PathHQ : Path1x);
+    // the vibrato and the lookahead delay can both be at their largest size
+    engine.idle.prepare(latency + maxDelaySize * 2 + maxBufferSize);
 
     setLatencySamples(latency);
 }
@@ -207,49 +244,31 @@ bool Nel19AudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) con
 
 void Nel19AudioProcessor::processBlock(AudioBufferF& buffer, MidiBuffer& midi)
 {
-    const auto numChannels = buffer.getNumChannels();
-    const auto numSamples = buffer.getNumSamples();
-    audioBufferD.setSize(numChannels, numSamples, true, false, true);
-    
-    auto samplesD = audioBufferD.getArrayOfWritePointers();
-    auto samplesF = buffer.getArrayOfWritePointers();
-
-    for(auto ch = 0; ch < numChannels; ++ch)
-        for (auto s = 0; s < numSamples; ++s)
-        {
-            const auto smplF = samplesF[ch][s];
-            const auto smplD = static_cast<double>(smplF);
-			samplesD[ch][s] = smplD;
-        }
-    
-    processBlock(audioBufferD, midi);
-
-    for (auto ch = 0; ch < numChannels; ++ch)
-        for (auto s = 0; s < numSamples; ++s)
-			samplesF[ch][s] = static_cast<float>(samplesD[ch][s]);
+    processBlockT(buffer, midi);
 }
 
 void Nel19AudioProcessor::processBlockBypassed(AudioBufferF& buffer, MidiBuffer&)
 {
-    auto samples = buffer.getArrayOfWritePointers();
-	auto numSamples = buffer.getNumSamples();
-
-    for (auto ch = 0; ch < buffer.getNumChannels(); ++ch)
-        SIMD::clear(samples[ch], buffer.getNumSamples());
+    processBlockBypassedT(buffer);
+}
 
-    params.processMacros();
+void Nel19AudioProcessor::processBlock(AudioBufferD& buffer, MidiBuffer& midi)
+{
+    processBlockT(buffer, midi);
+}
 
-    if (numSamples == 0)
-    {
-        for (auto& v : visualizerValues)
-            v = 0.;
-        return;
-    }
+void Nel19AudioProcessor::processBlockBypassed(AudioBufferD& buffer, MidiBuffer&)
+{
+    processBlockBypassedT(buffer);
 }
 
-void Nel19AudioProcessor::processBlock(AudioBufferD& buffer, MidiBuffer& midi)
+template<typename Float>
+void Nel19AudioProcessor::processBlockT(juce::AudioBuffer<Float>& buffer, MidiBuffer& midi) noexcept
 {
     juce::ScopedNoDenormals noDenormals;
+    auto& engine = getEngine<Float>();
+    auto& sidechain = engine.sidechain;
+    auto& dryWet = engine.dryWet;
     const auto numSamples = buffer.getNumSamples();
     {
         const auto numChannelsIn = getTotalNumInputChannels();
@@ -279,9 +298,26 @@ void Nel19AudioProcessor::processBlock(AudioBufferD& buffer, MidiBuffer& midi)
 
     const auto samplesMainRead = sidechain.samplesMainRead;
     const auto numChannels = sidechain.numChannels;
+#if !DebugModsBuffer
+    if (engine.idle.processInput(samplesMainRead, numChannels, numSamples))
+    {
+        // nothing rings in the delay lines anymore, so only the modulators keep up with transport and midi
+        processBlockModulators<Float>(midi, numSamples);
+        const auto modsMixV = params(modSys6::PID::ModsMix).getValueSum();
+        const auto depthV = params(modSys6::PID::Depth).getValueSum();
+        for (auto ch = 0; ch < numChannels; ++ch)
+        {
+            const auto mod0 = modulators[0].buffer[ch][numSamples - 1];
+            const auto mod1 = modulators[1].buffer[ch][numSamples - 1];
+            visualizerValues[ch] = (mod0 + modsMixV * (mod1 - mod0)) * depthV;
+            SIMD::clear(sidechain.samplesMain[ch], numSamples);
+        }
+        return;
+    }
+#endif
     const auto dryWetMix = params(modSys6::PID::DryWetMix).getValueSum();
     const auto lookaheadEnabled = params(modSys6::PID::Lookahead).getValueSum() > .5f;
-    dryWet.saveDry(samplesMainRead, dryWetMix, numChannels, numSamples, lookaheadEnabled);
+    dryWet.saveDry(samplesMainRead, dryWetMix, numChannels, numSamples);
 
     auto samplesMain = sidechain.samplesMain;
     
@@ -304,24 +340,136 @@ void Nel19AudioProcessor::processBlock(AudioBufferD& buffer, MidiBuffer& midi)
     
     const auto gainWet = params(modSys6::PID::WetGain).getValSumDenorm();
     dryWet.processWet(samplesMain, gainWet, numChannels, numSamples);
+    engine.idle.processOutput(samplesMain, numChannels, numSamples);
 }
 
-void Nel19AudioProcessor::processBlockVibrato(AudioBufferD& bufferAll, const MidiBuffer& midi,
+template<typename Float>
+void Nel19AudioProcessor::processBlockVibrato(juce::AudioBuffer<Float>& bufferAll, const MidiBuffer& midi,
     bool lookaheadEnabled) noexcept
 {
-    
+    auto& engine = getEngine<Float>();
+    auto& sidechain = engine.sidechain;
+    auto& pathSwitch = engine.pathSwitch;
 #if OversamplingEnabled && !DebugModsBuffer
-    auto& buffer = oversampling.upsample(bufferAll);
-    const auto osEnabled = oversampling.isEnabled();
-#else
-    auto& buffer = bufferAll;
+    const auto hqEnabled = params(modSys6::PID::HQ).getValueSum() > .5f;
+    if (pathSwitch.setPath(hqEnabled ? PathHQ : Path1x))
+    {
+        // the path that fades in starts from silence and fills its delay lines during the warm-up
+        if (pathSwitch.getTarget() == PathHQ)
+            engine.vibrat.reset();
+        else
+            engine.vibrat1x.reset();
+    }
 #endif
-    sidechain.setBufferUpsampled(&buffer);
+    if (!lookaheadEnabled)
+    {
+        // without lookahead the buffer size doesn't move the latency, so it follows the parameter live
+        const auto bufferSizeMs = static_cast<double>(params(modSys6::PID::BufferSize).getValSumDenorm());
+        const auto delaySize = getDelaySize(getSampleRate(), bufferSizeMs);
+        engine.vibrat.setSize(delaySize * engine.oversampling.getOrder());
+        engine.vibrat1x.setSize(delaySize);
+    }
+    {
+        // all voices share one write head and one oversampling pass
+        const auto numVoices = static_cast<int>(std::round(params(modSys6::PID::Voices).getValSumDenorm()));
+        const auto spread = static_cast<double>(params(modSys6::PID::VoicesSpread).getValueSum());
+        engine.vibrat.setVoices(numVoices, spread);
+        engine.vibrat1x.setVoices(numVoices, spread);
+    }
     
     const auto numChannels = sidechain.numChannels;
-    const auto numSamples = buffer.getNumSamples();
-    const auto samplesMainRead = sidechain.samplesMainReadUpsampled;
-    const auto samplesSCRead = sidechain.samplesSCReadUpsampled;
+    const auto numSamples1x = bufferAll.getNumSamples();
+
+    processBlockModulators<Float>(midi, numSamples1x);
+    
+    auto modsBuf = modsBuffer.getArrayOfWritePointers();
+
+    double* depthBuf;
+
+    // identical modulator channels mix into identical mod channels, so the delays can share their read heads
+    const auto modsLinked = numChannels == 2 && modulators[0].isLinked() && modulators[1].isLinked();
+
+    // FILL MODBUFFER WITH MODULATORS
+    {
+        const auto modsMixV = params(modSys6::PID::ModsMix).getValueSum();
+        const auto depthV = params(modSys6::PID::Depth).getValueSum();
+
+        auto modsMixInfo = modsMix(modsMixV, numSamples1x);
+        auto depthInfo = depth(depthV, numSamples1x);
+        depthBuf = depthInfo.buf;
+
+        if (!modsMixInfo.smoothing)
+            SIMD::fill(modsMixInfo.buf, modsMixV, numSamples1x);
+        if (!depthInfo.smoothing)
+            SIMD::fill(depthBuf, depthV, numSamples1x);
+
+        for (auto ch = 0; ch < (modsLinked ? 1 : numChannels); ++ch)
+        {
+            const auto mod0 = modulators[0].buffer[ch].data();
+            const auto mod1 = modulators[1].buffer[ch].data();
+            auto& visualizer = visualizerValues[ch];
+            auto mAll = modsBuf[ch];
+            for (auto s = 0; s < numSamples1x; ++s)
+            {
+                const auto modMixed = mod0[s] + modsMixInfo.buf[s] * (mod1[s] - mod0[s]);
+                const auto modGained = modMixed * depthBuf[s];
+                const auto modShifted = modGained - 1.f;
+                const auto modOut = modShifted + depthInfo.buf[s] * (modGained - modShifted);
+                mAll[s] = modOut;
+                visualizer = modGained;
+            }
+        }
+        if (modsLinked)
+        {
+            SIMD::copy(modsBuf[1], modsBuf[0], numSamples1x);
+            visualizerValues[1] = visualizerValues[0];
+        }
+    }
+
+#if DebugModsBuffer
+    const auto depthV = params(modSys6::PID::Depth).getValueSum();
+    for (auto ch = 0; ch < numChannels; ++ch)
+    {
+        const auto mAll = modsBuf[ch];
+        auto samples = bufferAll.getWritePointer(ch);
+        for (auto s = 0; s < numSamples1x; ++s)
+            samples[s] = static_cast<Float>(mAll[s] * depthV);
+        visualizerValues[ch] = mAll[numSamples1x - 1];
+    }
+#else
+    if (!pathSwitch.isSwitching())
+    {
+        if (pathSwitch.getPath() == PathHQ)
+            processPathHQ(bufferAll, numChannels, modsBuf, depthBuf, lookaheadEnabled, modsLinked);
+        else
+            processPath1x(sidechain.samplesMain, numChannels, numSamples1x, modsBuf, depthBuf, lookaheadEnabled, modsLinked);
+        return;
+    }
+
+    // while switching both paths run and get crossfaded.
+    // the delays turn the mods into read heads in place, so the 1x path gets its own copy
+    auto samples1x = engine.buffer1x.getArrayOfWritePointers();
+    auto modsBuf1x = modsBuffer1x.getArrayOfWritePointers();
+    auto depthBuf1x = depthBuffer1x.getWritePointer(0);
+    for (auto ch = 0; ch < numChannels; ++ch)
+    {
+        SIMD::copy(samples1x[ch], sidechain.samplesMainRead[ch], numSamples1x);
+        SIMD::copy(modsBuf1x[ch], modsBuf[ch], numSamples1x);
+    }
+    SIMD::copy(depthBuf1x, depthBuf, numSamples1x);
+    processPathHQ(bufferAll, numChannels, modsBuf, depthBuf, lookaheadEnabled, modsLinked);
+    processPath1x(samples1x, numChannels, numSamples1x, modsBuf1x, depthBuf1x, lookaheadEnabled, modsLinked);
+    pathSwitch(sidechain.samplesMain, samples1x, numChannels, numSamples1x);
+#endif
+}
+
+template<typename Float>
+void Nel19AudioProcessor::processBlockModulators(const MidiBuffer& midi, int numSamples) noexcept
+{
+    auto& sidechain = getEngine<Float>().sidechain;
+    const auto numChannels = sidechain.numChannels;
+    const auto samplesMainRead = sidechain.samplesMainRead;
+    const auto samplesSCRead = sidechain.samplesSCRead;
 
     using namespace modSys6;
 
@@ -419,77 +567,84 @@ void Nel19AudioProcessor::processBlockVibrato(AudioBufferD& bufferAll, const Mid
             numSamples
         );
     }
-    
-    auto modsBuf = modsBuffer.getArrayOfWritePointers();
-
-    double* depthBuf;
-
-    // FILL MODBUFFER WITH MODULATORS
-    {
-        const auto modsMixV = params(modSys6::PID::ModsMix).getValueSum();
-        const auto depthV = params(modSys6::PID::Depth).getValueSum();
-
-        auto modsMixInfo = modsMix(modsMixV, numSamples);
-        auto depthInfo = depth(depthV, numSamples);
-        depthBuf = depthInfo.buf;
+}
 
-        if (!modsMixInfo.smoothing)
-            SIMD::fill(modsMixInfo.buf, modsMixV, numSamples);
-        if (!depthInfo.smoothing)
-            SIMD::fill(depthBuf, depthV, numSamples);
+template<typename Float>
+void Nel19AudioProcessor::processPathHQ(juce::AudioBuffer<Float>& bufferAll, int numChannels,
+    double* const* modsBuf, double* depthBuf, bool lookaheadEnabled, bool modsLinked) noexcept
+{
+    auto& engine = getEngine<Float>();
+    auto& oversampling = engine.oversampling;
+    const auto numSamples1x = bufferAll.getNumSamples();
 
-        for (auto ch = 0; ch < numChannels; ++ch)
-        {
-            const auto mod0 = modulators[0].buffer[ch].data();
-            const auto mod1 = modulators[1].buffer[ch].data();
-            auto& visualizer = visualizerValues[ch];
-            auto mAll = modsBuf[ch];
-            for (auto s = 0; s < numSamples; ++s)
-            {
-                const auto modMixed = mod0[s] + modsMixInfo.buf[s] * (mod1[s] - mod0[s]);
-                const auto modGained = modMixed * depthBuf[s];
-                const auto modShifted = modGained - 1.f;
-                const auto modOut = modShifted + depthInfo.buf[s] * (modGained - modShifted);
-                mAll[s] = modOut;
-                visualizer = modGained;
-            }
-        }
-    }
+    auto& buffer = oversampling.upsample(bufferAll);
+    const auto osEnabled = oversampling.isEnabled();
+    engine.sidechain.setBufferUpsampled(&buffer);
 
-#if DebugModsBuffer
-    const auto depthV = params(modSys6::PID::Depth).getValueSum();
-    for (auto ch = 0; ch < numChannels; ++ch)
+    if (osEnabled)
     {
-        const auto mAll = modsBuf[ch];
-        auto samples = buffer.getWritePointer(ch);
-        for (auto s = 0; s < numSamples; ++s)
-            samples[s] = mAll[s] * depthV;
-        visualizerValues[ch] = mAll[numSamples - 1];
+        auto modsBufUp = modsBufferUp.getArrayOfWritePointers();
+        auto depthBufUp = depthBufferUp.getWritePointer(0);
+        // audio rate modulators have content up to the base rate's nyquist, which linear interpolation would mirror above it
+        const auto audioRate = std::find(modType.begin(), modType.end(), vibrato::ModType::AudioRate) != modType.end();
+        modsUpsampler(modsBufUp, modsBuf, numChannels, numSamples1x, audioRate);
+        depthUpsampler(&depthBufUp, &depthBuf, 1, numSamples1x, false);
+        modsBuf = modsBufUp;
+        depthBuf = depthBufUp;
+        // the upsampler of each channel still rings with what it got before the mods linked
+        const auto numSamplesUp = buffer.getNumSamples();
+        modsLinked = modsLinked && std::equal(modsBuf[0], modsBuf[0] + numSamplesUp, modsBuf[1]);
     }
-#else
+
     const auto feedback = static_cast<double>(params(modSys6::PID::Feedback).getValSumDenorm());
     const auto dampHz = static_cast<double>(params(modSys6::PID::Damp).getValSumDenorm());
-    vibrat
+    engine.vibrat
     (
         buffer.getArrayOfWritePointers(),
         numChannels,
-        numSamples,
+        buffer.getNumSamples(),
         modsBuf,
         depthBuf,
         feedback,
         dampHz,
-        osEnabled ? vibrato::InterpolationType::Lerp : vibrato::InterpolationType::Spline,
-        lookaheadEnabled
+        // at order 1 this reads at the base rate like the 1x path, so it needs the same kernel
+        osEnabled ? vibrato::InterpolationType::Lerp : vibrato::InterpolationType::Sinc8,
+        lookaheadEnabled,
+        modsLinked
     );
-#endif
 
-#if OversamplingEnabled && !DebugModsBuffer
     if (osEnabled)
         oversampling.downsample(bufferAll);
-#endif
 }
 
-void Nel19AudioProcessor::processBlockBypassed(AudioBufferD& buffer, MidiBuffer&)
+template<typename Float>
+void Nel19AudioProcessor::processPath1x(Float* const* samples, int numChannels, int numSamples,
+    double* const* modsBuf, double* depthBuf, bool lookaheadEnabled, bool modsLinked) noexcept
+{
+    auto& engine = getEngine<Float>();
+
+    const auto feedback = static_cast<double>(params(modSys6::PID::Feedback).getValSumDenorm());
+    const auto dampHz = static_cast<double>(params(modSys6::PID::Damp).getValSumDenorm());
+    engine.vibrat1x
+    (
+        samples,
+        numChannels,
+        numSamples,
+        modsBuf,
+        depthBuf,
+        feedback,
+        dampHz,
+        vibrato::InterpolationType::Sinc8,
+        lookaheadEnabled,
+        modsLinked
+    );
+
+    if (engine.oversampling.getLatency() != 0)
+        engine.delay1x(samples, numChannels, numSamples);
+}
+
+template<typename Float>
+void Nel19AudioProcessor::processBlockBypassedT(juce::AudioBuffer<Float>& buffer) noexcept
 {
     juce::ScopedNoDenormals noDenormals;
     const auto numSamples = buffer.getNumSamples();
@@ -498,12 +653,11 @@ void Nel19AudioProcessor::processBlockBypassed(AudioBufferD& buffer, MidiBuffer&
         return;
 	auto numChannels = buffer.getNumChannels();
     auto samples = buffer.getArrayOfWritePointers();
-    dryWet.processBypass
+    getEngine<Float>().dryWet.processBypass
     (
         samples,
         numChannels,
-        numSamples,
-        params(modSys6::PID::Lookahead).getValueSum() > .5f
+        numSamples
     );
 }
 
@@ -607,24 +761,59 @@ void Nel19AudioProcessor::timerCallback()
 {
     using PID = modSys6::PID;
 #if OversamplingEnabled && !DebugModsBuffer
-    const bool oversamplingChanged = (params(PID::HQ).getValueSum() > .5f) != oversampling.isEnabled();
+    const bool oversamplingChanged = isUsingDoublePrecision() ?
+        hasOversamplingChanged(engineD.oversampling) :
+        hasOversamplingChanged(engineF.oversampling);
 #else
 	const bool oversamplingChanged = false;
 #endif
-	const auto bufferSize = static_cast<int>(std::round(params(PID::BufferSize).getValSumDenorm()));
-    const auto bufferSizeVibrato = static_cast<int>(std::round(vibrat.getSizeInMs(oversampling.getSampleRateUpsampled())));
-    //DBG(bufferSize << " :: " << bufferSizeVibrato);
-    const bool bufferSizeChanged = bufferSize != bufferSizeVibrato;
-    
+    const auto osLatency = isUsingDoublePrecision() ? engineD.oversampling.getLatency() : engineF.oversampling.getLatency();
     const auto curLatency = getLatencySamples();
-    const auto latencyWithoutOversampling = curLatency - oversampling.getLatency();
+    const auto latencyWithoutOversampling = curLatency - osLatency;
     const auto hasLatency = latencyWithoutOversampling != 0;
-    const bool lookaheadChanged = (params(PID::Lookahead).getValueSum() > .5f) != hasLatency;
+    const auto lookaheadEnabled = params(PID::Lookahead).getValueSum() > .5f;
+    const bool lookaheadChanged = lookaheadEnabled != hasLatency;
+
+    // the audio thread follows the buffer size on its own, unless the lookahead turns it into latency
+    const auto delaySize = getDelaySize(getSampleRate(), static_cast<double>(params(PID::BufferSize).getValSumDenorm()));
+    const bool bufferSizeChanged = lookaheadEnabled && latencyWithoutOversampling != delaySize / 2;
     
     if (oversamplingChanged || lookaheadChanged || bufferSizeChanged)
         forcePrepare();
 }
 
+oversampling::Factor Nel19AudioProcessor::getOversamplingFactor() const
+{
+    using PID = modSys6::PID;
+    const auto factorIdx = static_cast<int>(std::round(params(PID::OversamplingFactor).getValSumDenorm()));
+    return static_cast<oversampling::Factor>(factorIdx);
+}
+
+int Nel19AudioProcessor::getOversamplingOrder(double sampleRate) const
+{
+    return oversampling::getOrder(sampleRate, getOversamplingFactor());
+}
+
+oversampling::FilterType Nel19AudioProcessor::getOversamplingFilterType() const
+{
+    using PID = modSys6::PID;
+    const auto lowLatency = params(PID::OversamplingLowLatency).getValueSum() > .5f;
+    // the convolution chain gets its low latency from minimum phase kernels instead of allpasses
+    if (getOversamplingFactor() == oversampling::Factor::FIR4)
+        return lowLatency ? oversampling::FilterType::IIRConvolutionMinPhase : oversampling::FilterType::IIRConvolution;
+    if (lowLatency)
+        return oversampling::FilterType::PolyphaseAllpass;
+    return oversampling::FilterType::Polyphase;
+}
+
+int Nel19AudioProcessor::getDelaySize(double sampleRate, double delaySizeMs) noexcept
+{
+    auto delaySize = static_cast<int>(std::round(sampleRate * delaySizeMs / 1000.));
+    if (delaySize % 2 != 0)
+        delaySize += 1;
+    return delaySize;
+}
+
 void Nel19AudioProcessor::forcePrepare()
 {
     suspendProcessing(true);
@@ -81,7 +81,10 @@ ich studiere.
 #include "modsys/ModSys.h"
 #include "BenchmarkProcessBlock.h"
 #include "dsp/Sidechain.h"
+#include "dsp/XFade.h"
+#include "dsp/IdleDetector.h"
 #include <limits>
+#include <type_traits>
 
 struct Nel19AudioProcessor :
     public juce::AudioProcessor,
@@ -100,6 +103,29 @@ struct Nel19AudioProcessor :
     using PRMInfo = dsp::PRMInfo<double>;
     using PID = modSys6::PID;
     static constexpr int NumActiveMods = 2;
+
+    /* the processing paths the HQ switch crossfades between */
+    enum Path { Path1x, PathHQ };
+
+    /*
+    * the audio path for one sample type, so float hosts don't convert to double and back.
+    * only the engine of the host's precision is prepared.
+    * both its vibrato paths (1x and HQ) are always prepared, so toggling HQ never reallocates.
+    */
+    template<typename Float>
+    struct Engine
+    {
+        dsp::Sidechain<Float> sidechain;
+        drywet::Processor<Float> dryWet;
+        oversampling::OversamplerWithShelf<Float> oversampling;
+        vibrato::Processor<Float> vibrat, vibrat1x;
+        /* delays the 1x path by the latency of the oversampler, so the reported latency doesn't depend on HQ */
+        drywet::FFDelay<Float> delay1x;
+        juce::AudioBuffer<Float> buffer1x;
+        dsp::PathSwitch<Float> pathSwitch;
+        /* skips the whole chain once input and feedback tail are silent */
+        dsp::IdleDetector<Float> idle;
+    };
     
     bool supportsDoublePrecisionProcessing() const override
     {
@@ -138,34 +164,70 @@ struct Nel19AudioProcessor :
     void loadPatch();
     juce::PropertiesFile::Options makeOptions();
     void forcePrepare();
+    oversampling::Factor getOversamplingFactor() const;
+    /* order of the HQ path, picked by the oversampling factor parameter */
+    int getOversamplingOrder(double sampleRate) const;
+    /* linear phase or low latency (allpass iir, or minimum phase kernels for the 4x fir chain) */
+    oversampling::FilterType getOversamplingFilterType() const;
+    /* sampleRate, delaySizeMs; the even delay size in samples at the base rate */
+    static int getDelaySize(double sampleRate, double delaySizeMs) noexcept;
     
     bool canAddBus(bool) const override;
 
     BusesProps makeBusesProps();
 
-    dsp::Sidechain sidechain;
-
     juce::ApplicationProperties appProperties;
     dsp::StandalonePlayHead standalonePlayHead;
-    AudioBufferD audioBufferD;
-
-    drywet::Processor dryWet;
 
     modSys6::Params params;
     
-    oversampling::OversamplerWithShelf oversampling;
+    Engine<float> engineF;
+    Engine<double> engineD;
     
     std::array<vibrato::Modulator, NumActiveMods> modulators;
-    AudioBufferD modsBuffer;
+    AudioBufferD modsBuffer, modsBufferUp, depthBufferUp;
+    /* the 1x path's own mods while the hq switch runs both paths */
+    AudioBufferD modsBuffer1x, depthBuffer1x;
+    oversampling::ControlUpsampler modsUpsampler, depthUpsampler;
     std::array<vibrato::ModType, NumActiveMods> modType;
     
-    vibrato::Processor vibrat;
-    
     std::array<double, 2> visualizerValues;
+
+    template<typename Float>
+    Engine<Float>& getEngine() noexcept
+    {
+        if constexpr (std::is_same<Float, float>::value)
+            return engineF;
+        else
+            return engineD;
+    }
 private:
     PRM depth, modsMix;
 
-    void processBlockVibrato(AudioBufferD&, const juce::MidiBuffer&, bool) noexcept;
+    template<typename Float>
+    void prepareToPlayT(double, int);
+    /* oversampler. true if the oversampling parameters no longer match the prepared oversampler */
+    template<class Oversampler>
+    bool hasOversamplingChanged(const Oversampler& oversampler) const
+    {
+        return getOversamplingOrder(getSampleRate()) != oversampler.getOrder() ||
+            getOversamplingFilterType() != oversampler.getFilterType();
+    }
+    template<typename Float>
+    void processBlockT(juce::AudioBuffer<Float>&, juce::MidiBuffer&) noexcept;
+    template<typename Float>
+    void processBlockBypassedT(juce::AudioBuffer<Float>&) noexcept;
+    template<typename Float>
+    void processBlockVibrato(juce::AudioBuffer<Float>&, const juce::MidiBuffer&, bool) noexcept;
+    /* midi, numSamples. synthesizes both modulators from the sidechain's buffers */
+    template<typename Float>
+    void processBlockModulators(const juce::MidiBuffer&, int) noexcept;
+    /* buffer, numChannels, modsBuf, depthBuf, lookaheadEnabled, modsLinked */
+    template<typename Float>
+    void processPathHQ(juce::AudioBuffer<Float>&, int, double* const*, double*, bool, bool) noexcept;
+    /* samples, numChannels, numSamples, modsBuf, depthBuf, lookaheadEnabled, modsLinked */
+    template<typename Float>
+    void processPath1x(Float* const*, int, int, double* const*, double*, bool, bool) noexcept;
     
     void timerCallback() override;
 
@@ -0,0 +1,189 @@
+#pragma once
+#if defined(__AVX2__)
+#define NEL_SIMD_AVX2 1
+#define NEL_SIMD_SSE2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEL_SIMD_AVX2 0
+#define NEL_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define NEL_SIMD_AVX2 0
+#define NEL_SIMD_SSE2 0
+#endif
+
+namespace vec
+{
+	/*
+	* the instruction set is picked at compile time (AVX2 > SSE2 > scalar),
+	* so every function here is a plain inline call without runtime dispatch.
+	* all loads are unaligned, because the callers slide windows over their buffers.
+	*/
+
+#if NEL_SIMD_AVX2
+	static constexpr int SizeDouble = 4;
+	static constexpr int SizeFloat = 8;
+
+	inline double sum(__m256d x) noexcept
+	{
+		const auto lo = _mm256_castpd256_pd128(x);
+		const auto hi = _mm256_extractf128_pd(x, 1);
+		const auto s = _mm_add_pd(lo, hi);
+		return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+	}
+
+	inline float sum(__m256 x) noexcept
+	{
+		const auto lo = _mm256_castps256_ps128(x);
+		const auto hi = _mm256_extractf128_ps(x, 1);
+		auto s = _mm_add_ps(lo, hi);
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+	}
+#elif NEL_SIMD_SSE2
+	static constexpr int SizeDouble = 2;
+	static constexpr int SizeFloat = 4;
+
+	inline double sum(__m128d x) noexcept
+	{
+		return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x)));
+	}
+
+	inline float sum(__m128 x) noexcept
+	{
+		const auto s = _mm_add_ps(x, _mm_movehl_ps(x, x));
+		return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+	}
+#else
+	static constexpr int SizeDouble = 1;
+	static constexpr int SizeFloat = 1;
+#endif
+
+	/* a, b, n; returns the sum of a[i] * b[i] */
+	inline double dot(const double* a, const double* b, int n) noexcept
+	{
+		auto i = 0;
+		auto y = 0.;
+#if NEL_SIMD_AVX2
+		auto acc0 = _mm256_setzero_pd();
+		auto acc1 = _mm256_setzero_pd();
+		for (; i + 8 <= n; i += 8)
+		{
+			acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+			acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+		}
+		for (; i + 4 <= n; i += 4)
+			acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+		y = sum(_mm256_add_pd(acc0, acc1));
+#elif NEL_SIMD_SSE2
+		auto acc0 = _mm_setzero_pd();
+		auto acc1 = _mm_setzero_pd();
+		for (; i + 4 <= n; i += 4)
+		{
+			acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+			acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+		}
+		for (; i + 2 <= n; i += 2)
+			acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+		y = sum(_mm_add_pd(acc0, acc1));
+#endif
+		for (; i < n; ++i)
+			y += a[i] * b[i];
+		return y;
+	}
+
+	/* a, b, n; returns the sum of a[i] * b[i] */
+	inline float dot(const float* a, const float* b, int n) noexcept
+	{
+		auto i = 0;
+		auto y = 0.f;
+#if NEL_SIMD_AVX2
+		auto acc = _mm256_setzero_ps();
+		for (; i + 8 <= n; i += 8)
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		y = sum(acc);
+#elif NEL_SIMD_SSE2
+		auto acc = _mm_setzero_ps();
+		for (; i + 4 <= n; i += 4)
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		y = sum(acc);
+#endif
+		for (; i < n; ++i)
+			y += a[i] * b[i];
+		return y;
+	}
+
+	/*
+	* h, x0, x1, n, y0, y1
+	* two dot products against the same kernel h (e.g. left and right channel),
+	* so every kernel load is shared by both channels.
+	*/
+	inline void dot2(const double* h, const double* x0, const double* x1, int n, double& y0, double& y1) noexcept
+	{
+		auto i = 0;
+		y0 = y1 = 0.;
+#if NEL_SIMD_AVX2
+		auto acc0 = _mm256_setzero_pd();
+		auto acc1 = _mm256_setzero_pd();
+		for (; i + 4 <= n; i += 4)
+		{
+			const auto hv = _mm256_loadu_pd(h + i);
+			acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(hv, _mm256_loadu_pd(x0 + i)));
+			acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(hv, _mm256_loadu_pd(x1 + i)));
+		}
+		y0 = sum(acc0);
+		y1 = sum(acc1);
+#elif NEL_SIMD_SSE2
+		auto acc0 = _mm_setzero_pd();
+		auto acc1 = _mm_setzero_pd();
+		for (; i + 2 <= n; i += 2)
+		{
+			const auto hv = _mm_loadu_pd(h + i);
+			acc0 = _mm_add_pd(acc0, _mm_mul_pd(hv, _mm_loadu_pd(x0 + i)));
+			acc1 = _mm_add_pd(acc1, _mm_mul_pd(hv, _mm_loadu_pd(x1 + i)));
+		}
+		y0 = sum(acc0);
+		y1 = sum(acc1);
+#endif
+		for (; i < n; ++i)
+		{
+			y0 += h[i] * x0[i];
+			y1 += h[i] * x1[i];
+		}
+	}
+
+	/* h, x0, x1, n, y0, y1 */
+	inline void dot2(const float* h, const float* x0, const float* x1, int n, float& y0, float& y1) noexcept
+	{
+		auto i = 0;
+		y0 = y1 = 0.f;
+#if NEL_SIMD_AVX2
+		auto acc0 = _mm256_setzero_ps();
+		auto acc1 = _mm256_setzero_ps();
+		for (; i + 8 <= n; i += 8)
+		{
+			const auto hv = _mm256_loadu_ps(h + i);
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(hv, _mm256_loadu_ps(x0 + i)));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(hv, _mm256_loadu_ps(x1 + i)));
+		}
+		y0 = sum(acc0);
+		y1 = sum(acc1);
+#elif NEL_SIMD_SSE2
+		auto acc0 = _mm_setzero_ps();
+		auto acc1 = _mm_setzero_ps();
+		for (; i + 4 <= n; i += 4)
+		{
+			const auto hv = _mm_loadu_ps(h + i);
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(hv, _mm_loadu_ps(x0 + i)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(hv, _mm_loadu_ps(x1 + i)));
+		}
+		y0 = sum(acc0);
+		y1 = sum(acc1);
+#endif
+		for (; i < n; ++i)
+		{
+			y0 += h[i] * x0[i];
+			y1 += h[i] * x1[i];
+		}
+	}
+}
\ No newline at end of file
@@ -1,36 +1,39 @@
 #pragma once
 #include "WHead.h"
+#include "RingBuffer.h"
 #include "../modsys/ModSys.h"
 #include "Smooth.h"
 
 namespace drywet
 {
-	using AudioBufferD = juce::AudioBuffer<double>;
-
+	template<typename Float>
 	struct FFDelay
 	{
 		FFDelay() :
 			wHead(),
 			ringBuffer(),
-			rHead(0)
+			rHead(0),
+			delay(0)
 		{}
 		
+		/* blockSize, delay in samples */
 		void prepare(int blockSize, int size)
 		{
-			wHead.prepare(blockSize, size);
-			ringBuffer.setSize(2, size, false, true, false);
+			delay = size;
+			// the ring needs one more sample than the delay, because every sample is written before it's read
+			ringBuffer.prepare(2, delay + 1);
+			wHead.prepare(blockSize, ringBuffer.getCapacity());
 			rHead.resize(blockSize);
 		}
 		
-		void operator()(double* const* samplesDry, int numChannels, int numSamples) noexcept
+		void operator()(Float* const* samplesDry, int numChannels, int numSamples) noexcept
 		{
 			synthesizeHeads(numSamples);
-			auto ringBuf = ringBuffer.getArrayOfWritePointers();
 
 			for (auto ch = 0; ch < numChannels; ++ch)
 			{
 				auto dry = samplesDry[ch];
-				auto ring = ringBuf[ch];
+				auto ring = ringBuffer[ch];
 
 				for (auto s = 0; s < numSamples; ++s)
 				{
@@ -43,17 +46,16 @@ namespace drywet
 			}
 		}
 		
-		void operator()(double* const* samplesDest, const double* const* samplesSrc,
+		void operator()(Float* const* samplesDest, const Float* const* samplesSrc,
 			int numChannels, int numSamples) noexcept
 		{
 			synthesizeHeads(numSamples);
-			auto ringBuf = ringBuffer.getArrayOfWritePointers();
 			
 			for (auto ch = 0; ch < numChannels; ++ch)
 			{
 				const auto src = samplesSrc[ch];
 				auto dest = samplesDest[ch];
-				auto ring = ringBuf[ch];
+				auto ring = ringBuffer[ch];
 
 				for (auto s = 0; s < numSamples; ++s)
 				{
@@ -68,23 +70,24 @@ namespace drywet
 	
 	protected:
 		dsp::WHead wHead;
-		AudioBufferD ringBuffer;
+		dsp::RingBuffer<Float> ringBuffer;
 		std::vector<int> rHead;
+		int delay;
 
 		void synthesizeHeads(int numSamples) noexcept
 		{
 			wHead(numSamples);
+			const auto mask = ringBuffer.getMask();
 			for (auto s = 0; s < numSamples; ++s)
-			{
-				rHead[s] = wHead[s] + 1;
-				if (rHead[s] >= wHead.delaySize)
-					rHead[s] -= wHead.delaySize;
-			}
+				rHead[s] = (wHead[s] - delay) & mask;
 		}
 	};
 
+	template<typename Float>
 	struct Processor
 	{
+		using AudioBuffer = juce::AudioBuffer<Float>;
+
 		enum
 		{
 			kL,
@@ -97,24 +100,28 @@ namespace drywet
 		};
 
 		Processor() :
-			mixSmooth(0.f),
+			mixSmooth(static_cast<Float>(0)),
 			delay(),
 			buffers(),
-			gainWet(420.f), gainWetVal(1.f),
-			gainWetSmooth(0.f)
+			gainWet(static_cast<Float>(420)), gainWetVal(static_cast<Float>(1)),
+			gainWetSmooth(static_cast<Float>(0)),
+			latency(0)
 		{
 		}
 		
-		void prepare(double sampleRate, int blockSize, int latency)
+		/* sampleRate, blockSize, latency (of the wet signal) */
+		void prepare(double sampleRate, int blockSize, int _latency)
 		{
-			mixSmooth.makeFromDecayInMs(10., sampleRate);
-			gainWetSmooth.makeFromDecayInMs(4., sampleRate);
+			latency = _latency;
+			const auto Fs = static_cast<Float>(sampleRate);
+			mixSmooth.makeFromDecayInMs(static_cast<Float>(10), Fs);
+			gainWetSmooth.makeFromDecayInMs(static_cast<Float>(4), Fs);
 			buffers.setSize(kNumChannels, blockSize, false, true, false);
-			delay.prepare(blockSize, latency);
+			if (latency != 0)
+				delay.prepare(blockSize, latency);
 		}
 		
-		void saveDry(const double* const* samples, double mixVal, int numChannels, int numSamples,
-			bool lookaheadEnabled) noexcept
+		void saveDry(const Float* const* samples, Float mixVal, int numChannels, int numSamples) noexcept
 		{
 			auto bufs = buffers.getArrayOfWritePointers();
 
@@ -125,12 +132,12 @@ namespace drywet
 			}
 			{ // MAKING EQUAL LOUDNESS CURVES
 				for (auto s = 0; s < numSamples; ++s)
-					bufs[kMixDry][s] = std::sqrt(1. - bufs[kMix][s]);
+					bufs[kMixDry][s] = std::sqrt(static_cast<Float>(1) - bufs[kMix][s]);
 				for (auto s = 0; s < numSamples; ++s)
 					bufs[kMixWet][s] = std::sqrt(bufs[kMix][s]);
 			}
 			
-			if(lookaheadEnabled)
+			if(latency != 0)
 				delay(bufs, samples, numChannels, numSamples);
 			else
 			{
@@ -139,14 +146,14 @@ namespace drywet
 			}
 		}
 		
-		void processWet(double* const* samples, double _gainWet, int numChannels, int numSamples) noexcept
+		void processWet(Float* const* samples, Float _gainWet, int numChannels, int numSamples) noexcept
 		{
 			auto bufs = buffers.getArrayOfWritePointers();
 
 			if (gainWet != _gainWet)
 			{
 				gainWet = _gainWet;
-				gainWetVal = juce::Decibels::decibelsToGain(gainWet, -120.);
+				gainWetVal = juce::Decibels::decibelsToGain(gainWet, static_cast<Float>(-120));
 			}
 			{
 				auto gainWetSmoothing = gainWetSmooth(bufs[kGainWet], gainWetVal, numSamples);
@@ -164,10 +171,9 @@ namespace drywet
 			}
 		}
 	
-		void processBypass(double* const* samples, int numChannels, int numSamples,
-			bool lookaheadEnabled) noexcept
+		void processBypass(Float* const* samples, int numChannels, int numSamples) noexcept
 		{
-			if (lookaheadEnabled)
+			if (latency != 0)
 				delay(samples, numChannels, numSamples);
 			else
 			{
@@ -178,11 +184,12 @@ namespace drywet
 		}
 
 	protected:
-		smooth::Smooth<double> mixSmooth;
-		FFDelay delay;
-		AudioBufferD buffers;
-		double gainWet, gainWetVal;
-		smooth::Smooth<double> gainWetSmooth;
+		smooth::Smooth<Float> mixSmooth;
+		FFDelay<Float> delay;
+		AudioBuffer buffers;
+		Float gainWet, gainWetVal;
+		smooth::Smooth<Float> gainWetSmooth;
+		int latency;
 	};
 }
 
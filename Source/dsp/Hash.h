@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+namespace dsp
+{
+	/*
+	* seed, index. counter based random numbers: every index of every seed is hashed on its own,
+	* so any value can be looked up without generating the ones before it.
+	* lowbias32 (C. Wellons) of a weyl sequence, returns [0, 1[
+	*/
+	inline double hashUnit(uint32_t seed, uint32_t index) noexcept
+	{
+		auto x = index + seed * 0x9e3779b9u;
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		// 24 bits fit a float's mantissa, so the values don't depend on the sample type
+		return static_cast<double>(x >> 8) * (1. / static_cast<double>(1 << 24));
+	}
+}
\ No newline at end of file
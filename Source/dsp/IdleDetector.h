@@ -0,0 +1,71 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <algorithm>
+#include <cmath>
+
+namespace dsp
+{
+	/*
+	* tells when a block can skip the whole chain, because its output would be silent anyway.
+	* that's the case once the input and the output have stayed below the threshold
+	* for longer than the longest path through the delay lines, so no feedback tail is left in them
+	*/
+	template<typename Float>
+	struct IdleDetector
+	{
+		IdleDetector() :
+			threshold(static_cast<Float>(0)),
+			numSilentSamples(0),
+			holdLength(0),
+			inputSilent(false)
+		{}
+
+		/* holdLength (samples), thresholdDb */
+		void prepare(int _holdLength, Float thresholdDb = static_cast<Float>(-96))
+		{
+			holdLength = _holdLength;
+			threshold = juce::Decibels::decibelsToGain(thresholdDb);
+			numSilentSamples = 0;
+			inputSilent = false;
+		}
+
+		/* samples, numChannels, numSamples. call before processing, returns true if the block can be skipped */
+		bool processInput(const Float* const* samples, int numChannels, int numSamples) noexcept
+		{
+			inputSilent = isSilent(samples, numChannels, numSamples);
+			if (!inputSilent)
+				numSilentSamples = 0;
+			return inputSilent && isIdle();
+		}
+
+		/* samples, numChannels, numSamples. call after processing a block that wasn't skipped */
+		void processOutput(const Float* const* samples, int numChannels, int numSamples) noexcept
+		{
+			if (inputSilent && isSilent(samples, numChannels, numSamples))
+				numSilentSamples = std::min(numSilentSamples + numSamples, holdLength);
+			else
+				numSilentSamples = 0;
+		}
+
+		bool isIdle() const noexcept
+		{
+			return numSilentSamples >= holdLength;
+		}
+
+	protected:
+		Float threshold;
+		int numSilentSamples, holdLength;
+		bool inputSilent;
+
+		bool isSilent(const Float* const* samples, int numChannels, int numSamples) const noexcept
+		{
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				const auto range = juce::FloatVectorOperations::findMinAndMax(samples[ch], numSamples);
+				if (std::max(-range.getStart(), range.getEnd()) > threshold)
+					return false;
+			}
+			return true;
+		}
+	};
+}
\ No newline at end of file
@@ -128,13 +128,7 @@ namespace dsp
                 }
             else
                 for (auto ch = 0; ch < numChannels; ++ch)
-                {
-                    auto smpls = samples[ch];
-                    for (auto s = 0; s < numSamples; ++s)
-                    {
-                        smpls[s] = wavetables(wtPosInfo.val, smpls[s]);
-                    }
-                }
+                    wavetables(samples[ch], wtPosInfo.val, samples[ch], numSamples);
         }
     };
 
@@ -5,6 +5,7 @@
 #include <random>
 #include "Smooth.h"
 #include "Perlin.h"
+#include "Hash.h"
 #include "Wavetable.h"
 #include "LFO2.h"
 #include "Macro.h"
@@ -19,6 +20,7 @@ namespace vibrato
 	static constexpr double PiHalf = Pi * .5;
 
 	using SmoothD = smooth::Smooth<double>;
+	using LowpassD = smooth::Lowpass<double>;
 	using String = juce::String;
 	using Identifier = juce::Identifier;
 	using ValueTree = juce::ValueTree;
@@ -327,6 +329,11 @@ namespace vibrato
 				perlin.setSeed(s);
 			}
 
+			double getWidth() const noexcept
+			{
+				return width;
+			}
+
 		protected:
 			perlin::Perlin2 perlin;
 			double rateHz, rateBeats;
@@ -335,69 +342,123 @@ namespace vibrato
 			bool temposync;
 		};
 
+		/*
+		* midi driven oscillators. every note gets a voice with its own envelope, glide and pitch,
+		* so chords don't collapse to the last note. every active voice gets a lane, and envelopes, phases,
+		* the cosine lookup and the envelope weighted sum step all lanes at once. the envelope is EnvGen's one pole
+		* with its stages, only the stage changes are checked per voice. the voices are summed up and normalised
+		* by their summed envelopes, so one voice sounds like the former mono version.
+		* pitchbend bends every voice by up to a semitone. once an mpe configuration message (rpn 6 on channel 1 or 16)
+		* sets up a zone, pitchbend on its member channels bends only the voices of that channel by up to MPEPBRange
+		* semitones, on top of the pitchbend of the zone's manager channel
+		*/
 		class AudioRate
 		{
 			static constexpr double PBGain = 2. / static_cast<double>(0x3fff);
+			static constexpr double MPEPBRange = 48.;
+			static constexpr int NumMidiChannels = 16;
+			// rpn 0/6 on a manager channel (1: lower zone, 16: upper zone) sets the number of member channels
+			static constexpr int RPNMCM = 6;
+			static constexpr int RPNNull = 127 << 7 | 127;
+			// a released voice below that level stops being rendered
+			static constexpr double SilenceThreshold = 1e-5;
+
+		public:
+			static constexpr int MaxNumVoices = 8;
 
-			struct Osc
+			struct Voice
 			{
-				Osc() :
-					phasor()
+				Voice() :
+					phase(0.), note(0.), env(0.),
+					lastNote(0.), lastFreq(noteToFreq(0.)),
+					channel(1), age(0),
+					stage(EnvGen::State::R),
+					gate(false)
 				{}
-				
-				void prepare(double sampleRate) noexcept
-				{
-					phasor.prepare(sampleRate);
-				}
-				
-				void setFrequencyHz(double f) noexcept
+
+				bool isActive() const noexcept
 				{
-					phasor.setFrequencyHz(f);
+					return gate || stage != EnvGen::State::R || env > SilenceThreshold;
 				}
-				
-				double operator()() noexcept
+
+				/* the stage changes of EnvGen. true if the stage changed, the envelope then holds for that sample */
+				bool updateStage() noexcept
 				{
-					phasor();
-					return std::cos(Tau * phasor.phase);
+					using State = EnvGen::State;
+					switch (stage)
+					{
+					case State::A:
+						if (!gate)
+							stage = State::R;
+						else if (env >= .999)
+							stage = State::D;
+						else
+							return false;
+						return true;
+					case State::D:
+						if (gate)
+							return false;
+						stage = State::R;
+						return true;
+					default:
+						if (!gate)
+							return false;
+						stage = State::A;
+						return true;
+					}
 				}
-				
-				double withPhaseOffset(Osc& other, double offset) const noexcept
+
+				/* midiN. the note only changes with midi events or retuning, so it's converted once per change */
+				double getFreq(double midiN) noexcept
 				{
-					const auto phase = other.phasor.phase + offset;
-					return std::cos(Tau * phase);
+					if (midiN != lastNote)
+					{
+						lastNote = midiN;
+						lastFreq = noteToFreq(midiN);
+					}
+					return lastFreq;
 				}
 
-				Phasor<double> phasor;
+				double phase, note, env;
+				// the last converted note and its frequency
+				double lastNote, lastFreq;
+				int channel, age;
+				EnvGen::State stage;
+				bool gate;
 			};
 			
-		public:
 			AudioRate() :
-				retuneSpeedSmooth(0.),
 				widthSmooth(0.),
 				widthBuf(),
-				
-				osc(),
-				env(),
+				envBuf(), phaseBufL(), phaseBufR(), envSumBuf(),
 
-				noteValue(0.), pitchbendValue(0.),
+				voices(),
+				pitchbends(),
+				rpns(),
+				pitchbend(0.),
+				numMembersLower(0), numMembersUpper(0),
+				voiceAge(0),
 
 				noteOffset(0.), width(0.), retuneSpeed(0.),
 				attack(1.), decay(1.), sustain(1.), release(1.),
+				stageA0(), stageB1(), stageTargets(),
 
 				Fs(1.)
 			{
-				osc.resize(2);
+				pitchbends.fill(0.);
+				rpns.fill(RPNNull);
 			}
 			
 			void prepare(double sampleRate, int blockSize)
 			{
 				Fs = sampleRate;
-				for(auto& o: osc)
-					o.prepare(sampleRate);
-				env.prepare(Fs);
-				retuneSpeedSmooth.makeFromDecayInMs(retuneSpeed, Fs);
+				updateStages();
 				widthSmooth.makeFromDecayInMs(10., Fs);
 				widthBuf.resize(blockSize);
+				envBuf.resize(blockSize * MaxNumVoices);
+				phaseBufL.resize(blockSize * MaxNumVoices);
+				phaseBufR.resize(blockSize * MaxNumVoices);
+				envSumBuf.resize(blockSize);
 			}
 			
 			void setParameters(double _noteOffset, double _width, double _retuneSpeed,
@@ -405,193 +466,381 @@ namespace vibrato
 			{
 				noteOffset = _noteOffset;
 				width = _width * .5;
-				if (retuneSpeed != _retuneSpeed)
-				{
-					retuneSpeed = _retuneSpeed;
-					retuneSpeedSmooth.makeFromDecayInMs(retuneSpeed, Fs);
-				}
+				retuneSpeed = _retuneSpeed;
+				if (attack == _attack && decay == _decay && sustain == _sustain && release == _release)
+					return;
 				attack = _attack;
-				env.attack = attack;
 				decay = _decay;
-				env.decay = decay;
 				release = _release;
-				env.release = release;
 				sustain = _sustain;
-				env.sustain = sustain;
+				updateStages();
 			}
 
 			void operator()(Buffer& buffer, const juce::MidiBuffer& midi,
 				int numChannels, int numSamples) noexcept
 			{
-				auto bufEnv = buffer[2].data();
+				// without width both channels are the same, so the right one is a copy
+				const auto smoothingWidth = numChannels == 2 && widthSmooth(widthBuf.data(), width, numSamples);
+				const auto numChannelsRendered = smoothingWidth || width != 0. ? numChannels : 1;
+
+				for (auto ch = 0; ch < numChannelsRendered; ++ch)
+					SIMD::clear(buffer[ch].data(), numSamples);
+				SIMD::clear(envSumBuf.data(), numSamples);
 
-				{ // SYNTHESIZE MIDI NOTE VALUES (0-127), PITCHBEND AND ENVELOPE
-					auto bufNotes = buffer[1].data();
-					auto currentValue = noteValue + pitchbendValue;
-					if (midi.isEmpty())
+				{ // RENDER THE VOICES BETWEEN MIDI EVENTS
+					auto s0 = 0;
+					for (const auto ref : midi)
 					{
-						for (auto s = 0; s < numSamples; ++s)
+						const auto ts = std::min(ref.samplePosition, numSamples);
+						if (ts > s0)
 						{
-							bufNotes[s] = currentValue;
-							bufEnv[s] = env();
-						}
-					}	
-					else
-					{
-						auto evt = midi.begin();
-						auto ref = *evt;
-						auto ts = ref.samplePosition;
-						for (auto s = 0; s < numSamples; ++s)
-						{
-							if (ts > s)
-							{
-								bufNotes[s] = currentValue;
-								bufEnv[s] = env();
-							}
-							else
-							{
-								bool noteOn = env.noteOn;
-								while (ts == s)
-								{
-									auto msg = ref.getMessage();
-									if (msg.isNoteOn())
-									{
-										noteValue = static_cast<double>(msg.getNoteNumber());
-										currentValue = noteValue + pitchbendValue;
-										noteOn = true;
-										env.retrig();
-									}
-									else if (msg.isNoteOff())
-									{
-										if(static_cast<int>(noteValue) == msg.getNoteNumber())
-											noteOn = false;
-									}
-									else if (msg.isPitchWheel())
-									{
-										const auto pwv = msg.getPitchWheelValue();
-										pitchbendValue = static_cast<double>(pwv) * PBGain - 1.;
-										currentValue = noteValue + pitchbendValue;
-									}
-									++evt;
-									if (evt == midi.end())
- 										ts = numSamples;
-									else
-									{
-										ref = *evt;
-										ts = ref.samplePosition;
-									}
-								}
-								bufNotes[s] = currentValue;
-								bufEnv[s] = env(noteOn);
-							}
+							processVoices(buffer, s0, ts, numChannelsRendered, smoothingWidth);
+							s0 = ts;
 						}
+						processMidi(ref.getMessage());
 					}
+					if (s0 < numSamples)
+						processVoices(buffer, s0, numSamples, numChannelsRendered, smoothingWidth);
 				}
-				{ // ADD OCT+SEMI+FINE SHIFT TO MIDI NOTE VALUE
+#if DebugAudioRateEnv
+				for (auto ch = 0; ch < numChannels; ++ch)
+					SIMD::copy(buffer[ch].data(), envSumBuf.data(), numSamples);
+#else
+				{ // NORMALISE BY THE SUMMED ENVELOPES
+					auto envSum = envSumBuf.data();
 					for (auto s = 0; s < numSamples; ++s)
-						buffer[1][s] += noteOffset;
+						envSum[s] = 1. / std::max(envSum[s], 1.);
+					for (auto ch = 0; ch < numChannelsRendered; ++ch)
+						SIMD::multiply(buffer[ch].data(), envSum, numSamples);
+					if (numChannelsRendered != numChannels)
+						SIMD::copy(buffer[1].data(), buffer[0].data(), numSamples);
 				}
-				{ // CONVERT MIDI NOTE VALUES TO FREQUENCIES HZ
-					for (auto s = 0; s < numSamples; ++s)
+#endif
+			}
+			
+			double getWidth() const noexcept
+			{
+				return width;
+			}
+			
+		protected:
+			SmoothD widthSmooth;
+			std::vector<double> widthBuf;
+			// the lanes of all active voices, [s * numLanes + lane]
+			std::vector<double> envBuf, phaseBufL, phaseBufR;
+			std::vector<double> envSumBuf;
+			
+			std::array<Voice, MaxNumVoices> voices;
+			std::array<double, NumMidiChannels> pitchbends;
+			// the selected rpn of each channel, msb << 7 | lsb
+			std::array<int, NumMidiChannels> rpns;
+			// the pitchbend outside of the mpe zones
+			double pitchbend;
+			int numMembersLower, numMembersUpper;
+			int voiceAge;
+
+			double noteOffset, width, retuneSpeed, attack, decay, sustain, release;
+			// the one pole of each envelope stage (EnvGen::State), shared by all voices
+			std::array<double, 3> stageA0, stageB1, stageTargets;
+			double Fs;
+
+			/* the coefficients of the envelope stages, like EnvGen's makeFromDecayInMs */
+			void updateStages() noexcept
+			{
+				const double decays[] = { attack, decay, release };
+				const double targets[] = { 1., sustain, 0. };
+				for (auto i = 0; i < 3; ++i)
+				{
+					const auto x = std::exp(-1. / (decays[i] * Fs * .001));
+					stageA0[i] = 1. - x;
+					stageB1[i] = x;
+					stageTargets[i] = targets[i];
+				}
+			}
+
+			static double noteToFreq(double midiN) noexcept
+			{
+				const auto freq = 440. * std::pow(2., (midiN - 69.) * .083333333333);
+				return juce::jlimit(1., 22049., freq);
+			}
+
+			/* channel [1, 16]. the manager channel of the mpe zone the channel is a member of, 0 outside of the zones */
+			int getManagerChannel(int channel) const noexcept
+			{
+				if (channel >= 2 && channel <= 1 + numMembersLower)
+					return 1;
+				if (channel <= 15 && channel >= NumMidiChannels - numMembersUpper)
+					return NumMidiChannels;
+				return 0;
+			}
+
+			/* channel [1, 16] */
+			double getPitchbend(int channel) const noexcept
+			{
+				const auto manager = getManagerChannel(channel);
+				if (manager == 0)
+					return pitchbend;
+				return pitchbends[manager - 1] + pitchbends[channel - 1] * MPEPBRange;
+			}
+
+			/* channel [1, 16], cc, value. follows the rpn selection and picks up mpe configuration messages */
+			void processController(int channel, int cc, int value) noexcept
+			{
+				auto& rpn = rpns[channel - 1];
+				switch (cc)
+				{
+				case 101: rpn = (value << 7) | (rpn & 127); return;
+				case 100: rpn = (rpn & ~127) | value; return;
+				// selecting an nrpn deselects the rpn
+				case 99: case 98: rpn = RPNNull; return;
+				case 6:
+					if (rpn != RPNMCM)
+						return;
+					// a new zone shrinks the other one, so they don't overlap
+					if (channel == 1)
+					{
+						numMembersLower = std::min(value, NumMidiChannels - 1);
+						numMembersUpper = std::min(numMembersUpper, std::max(NumMidiChannels - 2 - numMembersLower, 0));
+					}
+					else if (channel == NumMidiChannels)
 					{
-						const auto midiN = buffer[1][s];
-						const auto freq = 440. * std::pow(2., (midiN - 69.) * .083333333333);
-						buffer[1][s] = juce::jlimit(1., 22049., freq);
+						numMembersUpper = std::min(value, NumMidiChannels - 1);
+						numMembersLower = std::min(numMembersLower, std::max(NumMidiChannels - 2 - numMembersUpper, 0));
 					}
+					return;
 				}
-				// PROCESS RETUNE SPEED OF OSC (FILTER CUTOFF)
-				auto retuningNow = retuneSpeedSmooth(buffer[1].data(), numSamples);
-#if DebugAudioRateEnv
-				{ // COPY ENVELOPE ONLY
-					for(auto ch = 0; ch < numChannelsOut; ++ch)
-						for (auto s = 0; s < numSamples; ++s)
-							buffer[ch][s] = bufEnv[s];
+			}
+
+			void processMidi(const juce::MidiMessage& msg) noexcept
+			{
+				const auto channel = msg.getChannel();
+				if (msg.isNoteOn())
+					noteOn(static_cast<double>(msg.getNoteNumber()), channel);
+				else if (msg.isNoteOff())
+				{
+					const auto note = static_cast<double>(msg.getNoteNumber());
+					for (auto& voice : voices)
+						if (voice.gate && voice.note == note && voice.channel == channel)
+							voice.gate = false;
 				}
-#else
-				{ // SYNTHESIZE OSCILLATOR
-					if(numChannels == 1)
-					{ // channel 0
-						auto& osci = osc[0];
-						auto buf = buffer[0].data();
-
-						if(retuningNow)
-							for (auto s = 0; s < numSamples; ++s)
+				else if (msg.isPitchWheel())
+				{
+					const auto pwv = msg.getPitchWheelValue();
+					const auto pb = static_cast<double>(pwv) * PBGain - 1.;
+					pitchbends[channel - 1] = pb;
+					if (getManagerChannel(channel) == 0)
+						pitchbend = pb;
+				}
+				// all notes off and all sound off are controllers too, so they go first
+				else if (msg.isAllNotesOff() || msg.isAllSoundOff())
+					for (auto& voice : voices)
+						voice.gate = false;
+				else if (msg.isController())
+					processController(channel, msg.getControllerNumber(), msg.getControllerValue());
+			}
+
+			/* note, channel. takes a free voice, otherwise the oldest released or the oldest voice */
+			void noteOn(double note, int channel) noexcept
+			{
+				Voice* target = nullptr;
+				for (auto& voice : voices)
+					if (voice.gate && voice.note == note && voice.channel == channel)
+						target = &voice;
+				if (target == nullptr)
+					for (auto& voice : voices)
+						if (!voice.isActive())
+						{
+							target = &voice;
+							break;
+						}
+				if (target == nullptr)
+					for (auto& voice : voices)
+						if (target == nullptr || (!voice.gate && target->gate) ||
+							(voice.gate == target->gate && voice.age < target->age))
+							target = &voice;
+
+				target->note = note;
+				target->channel = channel;
+				target->gate = true;
+				target->age = ++voiceAge;
+				target->stage = EnvGen::State::A;
+			}
+
+			// the active voices, one per lane
+			using Lanes = std::array<Voice*, MaxNumVoices>;
+
+			/* buffer, s0, s1, numChannels, smoothingWidth. adds the voices in [s0, s1[ */
+			void processVoices(Buffer& buffer, int s0, int s1, int numChannels, bool smoothingWidth) noexcept
+			{
+				Lanes lanes;
+				auto numActive = 0;
+				for (auto& voice : voices)
+					if (voice.isActive())
+						lanes[numActive++] = &voice;
+				if (numActive == 0)
+					return;
+
+				// the lane count is a compile time constant, so the loops across the lanes unroll
+				if (numActive == 1)
+					processLanes<1>(buffer, lanes, numActive, s0, s1, numChannels, smoothingWidth);
+				else if (numActive == 2)
+					processLanes<2>(buffer, lanes, numActive, s0, s1, numChannels, smoothingWidth);
+				else if (numActive <= 4)
+					processLanes<4>(buffer, lanes, numActive, s0, s1, numChannels, smoothingWidth);
+				else
+					processLanes<MaxNumVoices>(buffer, lanes, numActive, s0, s1, numChannels, smoothingWidth);
+			}
+
+			/*
+			* buffer, lanes, numActive, s0, s1, numChannels, smoothingWidth.
+			* lanes beyond numActive are silent and stand still
+			*/
+			template<int NumLanes>
+			void processLanes(Buffer& buffer, const Lanes& lanes, int numActive,
+				int s0, int s1, int numChannels, bool smoothingWidth) noexcept
+			{
+				using Lane = std::array<double, NumLanes>;
+				const auto numSamples = s1 - s0;
+				const auto numValues = numSamples * NumLanes;
+				const auto fsInv = 1. / Fs;
+				auto env = envBuf.data();
+				auto phL = phaseBufL.data();
+				auto phR = phaseBufR.data();
+
+				// a frequency only changes with midi events, so the increment of each lane holds for the segment
+				Lane envs, targets, a0s, b1s, incs, phases, holds;
+				envs.fill(0.); targets.fill(0.); a0s.fill(0.); b1s.fill(0.);
+				incs.fill(0.); phases.fill(0.); holds.fill(0.);
+				for (auto l = 0; l < numActive; ++l)
+				{
+					const auto& voice = *lanes[l];
+					const auto midiN = voice.note + getPitchbend(voice.channel) + noteOffset;
+					incs[l] = lanes[l]->getFreq(midiN) * fsInv;
+					envs[l] = voice.env;
+					phases[l] = voice.phase;
+				}
+
+				// the gates only change at midi events, so only the first sample or an attack can change a stage
+				auto numAttacking = 1;
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					auto holding = false;
+					if (numAttacking != 0)
+					{
+						numAttacking = 0;
+						for (auto l = 0; l < numActive; ++l)
+						{
+							auto& voice = *lanes[l];
+							voice.env = envs[l];
+							if (voice.updateStage())
 							{
-								const auto freq = buffer[1][s];
-								osci.setFrequencyHz(freq);
-								buf[s] = osci() * bufEnv[s];
+								holds[l] = 1.;
+								holding = true;
 							}
-						else
-						{
-							const auto freq = buffer[1][0];
-							osci.setFrequencyHz(freq);
-							for (auto s = 0; s < numSamples; ++s)
-								buf[s] = osci() * bufEnv[s];
+							const auto st = static_cast<int>(voice.stage);
+							targets[l] = stageTargets[st];
+							a0s[l] = stageA0[st];
+							b1s[l] = stageB1[st];
+							numAttacking += voice.stage == EnvGen::State::A ? 1 : 0;
 						}
 					}
+
+					const auto i = s * NumLanes;
+					if (!holding)
+						for (auto l = 0; l < NumLanes; ++l)
+							envs[l] = targets[l] * a0s[l] + envs[l] * b1s[l];
 					else
-					{ // PROCESS STEREO WIDTH
-						auto& osciL = osc[0];
-						auto& osciR = osc[1];
-						auto bufL = buffer[0].data();
-						auto bufR = buffer[1].data();
-						
-						auto smoothingWidth = widthSmooth(widthBuf.data(), width, numSamples);
-
-						if (retuningNow)
-							if(smoothingWidth)
-								for (auto s = 0; s < numSamples; ++s)
-								{
-									const auto freq = bufR[s];
-									osciL.setFrequencyHz(freq);
-									bufL[s] = osciL() * bufEnv[s];
-									bufR[s] = osciR.withPhaseOffset(osciL, widthBuf[s] * bufEnv[s]);
-								}
-							else
-								for (auto s = 0; s < numSamples; ++s)
-								{
-									const auto freq = bufR[s];
-									osciL.setFrequencyHz(freq);
-									bufL[s] = osciL() * bufEnv[s];
-									bufR[s] = osciR.withPhaseOffset(osciL, width * bufEnv[s]);
-								}
-						else
+					{
+						for (auto l = 0; l < NumLanes; ++l)
 						{
-							const auto freq = bufR[0];
-							osciL.setFrequencyHz(freq);
-							if (smoothingWidth)
-								for (auto s = 0; s < numSamples; ++s)
-								{
-									bufL[s] = osciL() * bufEnv[s];
-									bufR[s] = osciR.withPhaseOffset(osciL, widthSmooth(width)) * bufEnv[s];
-								}
-							else
-								for (auto s = 0; s < numSamples; ++s)
-								{
-									bufL[s] = osciL() * bufEnv[s];
-									bufR[s] = osciR.withPhaseOffset(osciL, width) * bufEnv[s];
-								}
+							const auto y = targets[l] * a0s[l] + envs[l] * b1s[l];
+							envs[l] = holds[l] != 0. ? envs[l] : y;
 						}
+						holds.fill(0.);
+					}
+					for (auto l = 0; l < NumLanes; ++l)
+					{
+						auto phase = phases[l] + incs[l];
+						if (phase >= 1.)
+							--phase;
+						phases[l] = phase;
+						env[i + l] = envs[l];
+						phL[i + l] = phase;
 					}
 				}
-#endif
+				for (auto l = 0; l < numActive; ++l)
+				{
+					lanes[l]->env = envs[l];
+					lanes[l]->phase = phases[l];
+				}
+
+				if (numChannels == 2)
+				{
+					const auto widths = widthBuf.data() + s0;
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						const auto w = smoothingWidth ? widths[s] : width;
+						const auto i = s * NumLanes;
+						for (auto l = 0; l < NumLanes; ++l)
+							phR[i + l] = wrap(phL[i + l] + w);
+					}
+					synthesize(phR, phR, numValues);
+					sumLanes<NumLanes, false>(buffer[1].data() + s0, nullptr, phR, env, numSamples);
+				}
+
+				synthesize(phL, phL, numValues);
+				sumLanes<NumLanes, true>(buffer[0].data() + s0, envSumBuf.data() + s0, phL, env, numSamples);
 			}
-			
-		protected:
-			SmoothD retuneSpeedSmooth, widthSmooth;
-			std::vector<double> widthBuf;
-			
-			std::vector<Osc> osc;
-			EnvGen env;
-			double noteValue, pitchbendValue;
 
-			double noteOffset, width, retuneSpeed, attack, decay, sustain, release;
-			double Fs;
+			/* out, envSum, waves, env, numSamples. adds the envelope weighted lanes (and the envelopes) of each sample */
+			template<int NumLanes, bool SumEnvs>
+			static void sumLanes(double* out, double* envSum, const double* waves, const double* env, int numSamples) noexcept
+			{
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					const auto i = s * NumLanes;
+					auto y = 0.;
+					auto e = 0.;
+					for (auto l = 0; l < NumLanes; ++l)
+					{
+						y += waves[i + l] * env[i + l];
+						if constexpr (SumEnvs)
+							e += env[i + l];
+					}
+					out[s] += y;
+					if constexpr (SumEnvs)
+						envSum[s] += e;
+				}
+			}
+
+			static double wrap(double phase) noexcept
+			{
+				return phase - std::floor(phase);
+			}
+
+			/* dest, phases, numSamples. the waveform at the phases, dest may be phases */
+			static void synthesize(double* dest, const double* phases, int numSamples) noexcept
+			{
+				dsp::shaping::cosine<double>(dest, phases, numSamples);
+			}
 		};
 
+		/*
+		* random impulses that fall back to 0 like a damped spring, then get shaped and smoothed.
+		* the impulses are scheduled: the samples until the next one follow from the phase of the phasor,
+		* and their values are hashed from a counter instead of drawn from a shared generator.
+		* the spring is linear as long as it doesn't cross 0, so it jumps SpringStride samples at once
+		* with the powers of its transition matrix, and stops once it settles at 0, its fixed point,
+		* so the rest of a run is filled with silence
+		*/
 		class Dropout
 		{
 			static constexpr double FreqCoeff = Pi * 10. * 10. * 10. * 10. * 10.;
+			// spring and lowpass states below that level are settled
+			static constexpr double SettledThreshold = 1e-9;
+			static constexpr int SpringStride = 4;
+			// a 2x2 matrix applied to { env, speed }, row by row
+			using Matrix = std::array<double, 4>;
 		
 		public:
 			Dropout() :
@@ -599,16 +848,18 @@ namespace vibrato
 				widthBuf(),
 				
 				phasor(),
-				decay(1.), spin(1.), freqChance(0.), freqSmooth(0.), width(0.),
-				rand(),
+				decay(1.), spin(1.), freqChance(1000.), freqSmooth(0.), width(0.),
+				seed(static_cast<uint32_t>(juce::Random::getSystemRandom().nextInt())),
+				impulseIdx{ 0, 0 },
 
-				accel{ 0., 0. },
 				speed{ 0., 0. },
-				dest{ 0., 0. },
 				env{ 0., 0. },
-				smooth{ 0., 0. },
-				fs(44100.), dcy(1.), spinV(420.)
-			{}
+				lowpass{ 0., 0. },
+				fs(44100.), dcy(1.), spinV(420.),
+				springPowers()
+			{
+				updateSpring();
+			}
 			
 			void prepare(double sampleRate, int blockSize)
 			{
@@ -621,13 +872,12 @@ namespace vibrato
 				}
 				
 				dcy = 1. - 1. / (decay * fs * .001);
-				for (auto& p : phasor)
-					p.setFrequencyMs(freqChance);
 				
-				for (auto& s : smooth)
-					s.makeFromFreqInHz(freqSmooth, fs);
+				for (auto& lp : lowpass)
+					lp.makeFromDecayInHz(freqSmooth, fs);
 				
 				spinV = 1. / (fs * FreqCoeff / (spin * spin));
+				updateSpring();
 				
 				widthSmooth.makeFromDecayInMs(10., fs);
 				widthBuf.resize(blockSize);
@@ -636,6 +886,7 @@ namespace vibrato
 			void setParameters(double _decay, double _spin,
 				double _freqChance, double _freqSmooth, double _width) noexcept
 			{
+				const auto springChanged = decay != _decay || spin != _spin;
 				if (decay != _decay)
 				{
 					decay = _decay;
@@ -647,6 +898,8 @@ namespace vibrato
 					const auto spin2 = spin * spin;
 					spinV = 1. / (fs * FreqCoeff / spin2);
 				}
+				if (springChanged)
+					updateSpring();
 				if (freqChance != _freqChance)
 				{
 					freqChance = _freqChance;
@@ -654,94 +907,201 @@ namespace vibrato
 						p.setFrequencyMs(freqChance);
 
 				}
-				freqSmooth = _freqSmooth;
+				if (freqSmooth != _freqSmooth)
+				{
+					freqSmooth = _freqSmooth;
+					for (auto& lp : lowpass)
+						lp.makeFromDecayInHz(freqSmooth, fs);
+				}
 				width = _width;
 			}
 			
 			void operator()(Buffer& buffer, int numChannels, int numSamples) noexcept
 			{
-				{ // FILL BUFFERS WITH IMPULSES
-					for (auto ch = 0; ch < numChannels; ++ch)
-					{
-						auto& phasr = phasor[ch];
-						auto impulseBuf = buffer[ch].data();
-						juce::FloatVectorOperations::fill(impulseBuf, 0., numSamples);
-						for (auto s = 0; s < numSamples; ++s)
-							if (phasr())
-								impulseBuf[s] = 2. * (rand.nextDouble() - .5);
-					}
-				}
-				
 				{ // SYNTHESIZE MOD
 					for (auto ch = 0; ch < numChannels; ++ch)
 					{
 						auto buf = buffer[ch].data();
+						const auto silent = processImpulses(buf, ch, numSamples);
 						
-						{
-							auto& ac = accel[ch];
-							auto& velo = speed[ch];
-							auto& dst = dest[ch];
-							auto& en = env[ch];
-
-							for (auto s = 0; s < numSamples; ++s)
-							{
-								auto& smpl = buf[s];
-								if (smpl != 0.)
-								{
-									en = smpl;
-									dst = 0.;
-									ac = 0.;
-									velo = 0.;
-								}
-								const auto dist = dst - en;
-								const auto direc = dist < 0. ? -1. : 1.;
-
-								ac = (velo * direc + dist) * spinV;
-								velo += ac;
-								en = (en + velo) * dcy;
-								smpl = en;
-							}
-						}
+						auto& lp = lowpass[ch];
+						if (silent && lp.y1 == 0.)
+							continue;
 						
-						for (auto s = 0; s < numSamples; ++s)
-						{
-							auto& smpl = buf[s];
-							smpl = approx::tanh(PiHalf * smpl * smpl * smpl);
-						}
+						dsp::shaping::dropout<double>(buf, buf, numSamples);
 
-						smooth[ch].makeFromFreqInHz(freqSmooth, fs);
+						lp(buf, numSamples);
 						for (auto s = 0; s < numSamples; ++s)
-						{
-							auto& smpl = buf[s];
-							smpl = static_cast<float>(smooth[ch](smpl));
-						}	
+							buf[s] = static_cast<float>(buf[s]);
+						if (silent && std::abs(lp.y1) < SettledThreshold)
+							lp.y1 = 0.;
 					}
 				}
 				
 				if (numChannels == 2)
 				{
 					const auto widthSmoothing = widthSmooth(widthBuf.data(), width, numSamples);
+					const auto bufL = buffer[0].data();
+					auto bufR = buffer[1].data();
 					
 					if(widthSmoothing)
 						for (auto s = 0; s < numSamples; ++s)
-							buffer[1][s] = buffer[0][s] + widthBuf[s] * (buffer[1][s] - buffer[0][s]);
+							bufR[s] = bufL[s] + widthBuf[s] * (bufR[s] - bufL[s]);
 					else
 						for (auto s = 0; s < numSamples; ++s)
-							buffer[1][s] = buffer[0][s] + width * (buffer[1][s] - buffer[0][s]);
+							bufR[s] = bufL[s] + width * (bufR[s] - bufL[s]);
 				}
 			}
 			
+			double getWidth() const noexcept
+			{
+				return width;
+			}
+			
 		protected:
 			SmoothD widthSmooth;
 			std::vector<double> widthBuf;
 
 			std::array<Phasor<double>, 2> phasor;
 			double decay, spin, freqChance, freqSmooth, width;
-			juce::Random rand;
+			// every channel hashes its own sequence of impulses
+			uint32_t seed;
+			std::array<uint32_t, 2> impulseIdx;
 
-			std::array<double, 2> accel, speed, dest, env;
-			std::array<SmoothD, 2> smooth;
+			std::array<double, 2> speed, env;
+			std::array<LowpassD, 2> lowpass;
 			double fs, dcy, spinV;
+			// 1 to SpringStride steps of the spring, pulling down [0] or up [1]
+			std::array<std::array<Matrix, SpringStride>, 2> springPowers;
+
+			static Matrix multiply(const Matrix& a, const Matrix& b) noexcept
+			{
+				return
+				{
+					a[0] * b[0] + a[1] * b[2], a[0] * b[1] + a[1] * b[3],
+					a[2] * b[0] + a[3] * b[2], a[2] * b[1] + a[3] * b[3]
+				};
+			}
+
+			void updateSpring() noexcept
+			{
+				for (auto i = 0; i < 2; ++i)
+				{
+					const auto direc = i == 0 ? -1. : 1.;
+					const Matrix step
+					{
+						dcy * (1. - spinV), dcy * (1. + direc * spinV),
+						-spinV, 1. + direc * spinV
+					};
+					auto power = step;
+					for (auto p = 0; p < SpringStride; ++p)
+					{
+						springPowers[i][p] = power;
+						power = multiply(step, power);
+					}
+				}
+			}
+
+			/* buf, ch, numSamples. the spring with its impulses, returns true if the whole block is silent */
+			bool processImpulses(double* buf, int ch, int numSamples) noexcept
+			{
+				auto& phasr = phasor[ch];
+				auto silent = true;
+				// s0 is where the spring continues, s the first sample whose phasor tick is pending
+				auto s0 = 0;
+				auto s = 0;
+				while (true)
+				{
+					const auto remaining = static_cast<double>(numSamples - s);
+					const auto samplesToImpulse = std::max(std::ceil((1. - phasr.phase) / phasr.inc), 1.);
+					if (samplesToImpulse > remaining)
+					{
+						phasr.phase += remaining * phasr.inc;
+						break;
+					}
+					phasr.phase = std::max(phasr.phase + samplesToImpulse * phasr.inc - 1., 0.);
+					const auto sImpulse = s + static_cast<int>(samplesToImpulse) - 1;
+					silent = processSpring(buf, ch, s0, sImpulse) && silent;
+					triggerImpulse(ch);
+					silent = false;
+					s0 = sImpulse;
+					s = sImpulse + 1;
+				}
+				return processSpring(buf, ch, s0, numSamples) && silent;
+			}
+
+			void triggerImpulse(int ch) noexcept
+			{
+				env[ch] = 2. * dsp::hashUnit(seed + static_cast<uint32_t>(ch), impulseIdx[ch]++) - 1.;
+				speed[ch] = 0.;
+			}
+
+			/* buf, ch, s0, s1. the spring from s0 to s1, returns true if it was settled all along */
+			bool processSpring(double* buf, int ch, int s0, int s1) noexcept
+			{
+				// locals, because buf could alias the members
+				auto velo = speed[ch];
+				auto en = env[ch];
+
+				if (en == 0. && velo == 0.)
+				{
+					juce::FloatVectorOperations::fill(buf + s0, 0., s1 - s0);
+					return true;
+				}
+
+				auto s = s0;
+				while (s < s1)
+				{
+					// the spring pulls towards 0
+					const auto pullsDown = en > 0.;
+
+					if (s + SpringStride <= s1)
+					{
+						const auto& powers = springPowers[pullsDown ? 0 : 1];
+						std::array<double, SpringStride> ens;
+						for (auto i = 0; i < SpringStride; ++i)
+							ens[i] = powers[i][0] * en + powers[i][1] * velo;
+						// every step but the last one has to pull the same way
+						auto linear = true;
+						for (auto i = 0; i < SpringStride - 1; ++i)
+							linear = linear && (ens[i] > 0.) == pullsDown;
+						if (linear)
+						{
+							const auto& last = powers[SpringStride - 1];
+							velo = last[2] * en + last[3] * velo;
+							en = ens[SpringStride - 1];
+							for (auto i = 0; i < SpringStride; ++i)
+								buf[s + i] = ens[i];
+							s += SpringStride;
+						}
+						else
+							processSpringStep(buf[s++], en, velo, pullsDown);
+					}
+					else
+						processSpringStep(buf[s++], en, velo, pullsDown);
+
+					if (std::abs(en) < SettledThreshold && std::abs(velo) < SettledThreshold)
+					{
+						en = 0.;
+						velo = 0.;
+						juce::FloatVectorOperations::fill(buf + s, 0., s1 - s);
+						break;
+					}
+				}
+				speed[ch] = velo;
+				env[ch] = en;
+				return false;
+			}
+
+			/* smpl, en, velo, pullsDown */
+			void processSpringStep(double& smpl, double& en, double& velo, bool pullsDown) const noexcept
+			{
+				const auto direc = pullsDown ? -1. : 1.;
+				const auto ac = (velo * direc - en) * spinV;
+				velo += ac;
+				en = (en + velo) * dcy;
+				smpl = en;
+			}
 		};
 
 		struct EnvFol
@@ -778,6 +1138,11 @@ namespace vibrato
 
 				envFol(samplesIn, samplesSC, attackMs, releaseMs, gain, width, numChannels, numSamples, scEnabled);
 			}
+
+			double getWidth() const noexcept
+			{
+				return width;
+			}
 			
 		protected:
 			envfol::EnvFol envFol;
@@ -936,6 +1301,11 @@ namespace vibrato
 					temposync
 				);
 			}
+
+			double getWidth() const noexcept
+			{
+				return width;
+			}
 		
 		protected:
 			dsp::LFO_Procedural lfo;
@@ -948,6 +1318,7 @@ namespace vibrato
 		Modulator() :
 			buffer(),
 			tables(),
+			input(),
 			perlin(),
 			audioRate(),
 			dropout(),
@@ -956,7 +1327,8 @@ namespace vibrato
 			pitchbend(),
 			lfo(tables),
 			
-			type(ModType::Perlin)
+			type(ModType::Perlin),
+			linked(false)
 		{
 			tables.makeTablesWeierstrass();
 		}
@@ -1020,6 +1392,8 @@ namespace vibrato
 		{
 			for(auto& b: buffer)
 				b.resize(maxBlockSize + 4, 0.f); // compensate for potential spline interpolation
+			for (auto& i : input)
+				i.resize(maxBlockSize, 0.);
 			perlin.prepare(sampleRate, maxBlockSize, latency);
 			audioRate.prepare(sampleRate, maxBlockSize);
 			dropout.prepare(sampleRate, maxBlockSize);
@@ -1074,20 +1448,52 @@ namespace vibrato
 			lfo.setParameters(isSync, rateFree, rateSync, waveform, phase, width);
 		}
 
+		/*
+		* modulators are control signals and always run in double.
+		* a float host only gets its audio converted for the modulators that listen to it (envfol, macro)
+		*/
+		void processBlock(const float* const* samples, const float* const* samplesSC,
+			const juce::MidiBuffer& midi, const PosInfo& transport,
+			int numChannels, int numSamples) noexcept
+		{
+			if (type != ModType::EnvFol && type != ModType::Macro)
+				return processBlock(static_cast<const double* const*>(nullptr), nullptr, midi, transport, numChannels, numSamples);
+
+			const double* samplesD[] = { input[0].data(), input[1].data() };
+			const double* samplesSCD[] = { input[2].data(), input[3].data() };
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				for (auto s = 0; s < numSamples; ++s)
+					input[ch][s] = static_cast<double>(samples[ch][s]);
+				for (auto s = 0; s < numSamples; ++s)
+					input[2 + ch][s] = static_cast<double>(samplesSC[ch][s]);
+			}
+			processBlock(samplesD, samplesSCD, midi, transport, numChannels, numSamples);
+		}
+
 		void processBlock(const double* const* samples, const double* const* samplesSC,
 			const juce::MidiBuffer& midi, const PosInfo& transport,
 			int numChannels, int numSamples) noexcept
 		{
 			switch (type)
 			{
-			case ModType::Perlin: return perlin(buffer, numChannels, numSamples, transport);
-			case ModType::AudioRate: return audioRate(buffer, midi, numChannels, numSamples);
-			case ModType::Dropout: return dropout(buffer, numChannels, numSamples);
-			case ModType::EnvFol: return envFol(buffer, samples, samplesSC, numChannels, numSamples);
-			case ModType::Macro: return macro(buffer, samplesSC, numChannels, numSamples);
-			case ModType::Pitchwheel: return pitchbend(buffer, numChannels, numSamples, midi);
-			case ModType::LFO: return lfo(buffer, numChannels, numSamples, transport);
+			case ModType::Perlin: perlin(buffer, numChannels, numSamples, transport); break;
+			case ModType::AudioRate: audioRate(buffer, midi, numChannels, numSamples); break;
+			case ModType::Dropout: dropout(buffer, numChannels, numSamples); break;
+			case ModType::EnvFol: envFol(buffer, samples, samplesSC, numChannels, numSamples); break;
+			case ModType::Macro: macro(buffer, samplesSC, numChannels, numSamples); break;
+			case ModType::Pitchwheel: pitchbend(buffer, numChannels, numSamples, midi); break;
+			case ModType::LFO: lfo(buffer, numChannels, numSamples, transport); break;
 			}
+
+			linked = numChannels != 2 ||
+				(mayBeLinked() && std::equal(buffer[0].begin(), buffer[0].begin() + numSamples, buffer[1].begin()));
+		}
+
+		/* true if both channels of the last block are identical, so stereo consumers can share their work */
+		bool isLinked() const noexcept
+		{
+			return linked;
 		}
 		
 		Tables& getTables() noexcept
@@ -1103,6 +1509,8 @@ namespace vibrato
 		Buffer buffer;
 	protected:
 		Tables tables;
+		/* the audio input (main, sidechain) converted to double, only used by float hosts */
+		Buffer input;
 
 		Perlin perlin;
 		AudioRate audioRate;
@@ -1113,6 +1521,21 @@ namespace vibrato
 		LFO lfo;
 
 		ModType type;
+		bool linked;
+
+		/* only a modulator without stereo width can output identical channels. the block is compared anyway */
+		bool mayBeLinked() const noexcept
+		{
+			switch (type)
+			{
+			case ModType::Perlin: return perlin.getWidth() == 0.;
+			case ModType::AudioRate: return audioRate.getWidth() == 0.;
+			case ModType::Dropout: return dropout.getWidth() == 0.;
+			case ModType::EnvFol: return envFol.getWidth() == 0.;
+			case ModType::LFO: return lfo.getWidth() == 0.;
+			default: return true;
+			}
+		}
 	};
 }
 
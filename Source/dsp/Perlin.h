@@ -1,9 +1,12 @@
 #pragma once
 #include <array>
-#include <random>
+#include <cstdint>
+#include <optional>
 #include "../Interpolation.h"
 #include "PRM.h"
 #include "Phasor.h"
+#include "ShapingTable.h"
+#include "Hash.h"
 
 #include <juce_audio_basics/juce_audio_basics.h>
 
@@ -32,9 +35,7 @@ namespace perlin
 	{
 		if (bias == 0.)
 			return x;
-		const auto X = 2. * x * x * x * x * x;
-		const auto Y = X * X * X;
-		return x + bias * (std::tanh(Y) - x);
+		return x + bias * (dsp::shaping::tanhX15<double>(x) - x);
 	}
 
 	inline void applyBias(double* smpls, double bias, int numSamples) noexcept
@@ -61,17 +62,17 @@ namespace perlin
 			applyBias(samples[ch], bias, numSamples);
 	}
 
-	inline void generateProceduralNoise(double* noise, int size, unsigned int seed)
+	/* seed, index. counter based noise (see dsp::hashUnit), returns [-.8, .8[ to compensate spline overshoot */
+	inline double hashNoise(uint32_t seed, uint32_t index) noexcept
 	{
-		std::random_device rd;
-		std::mt19937 mt(rd());
-		std::uniform_real_distribution<float> dist(-.8f, .8f); // compensate spline overshoot
+		return -.8 + 1.6 * dsp::hashUnit(seed, index);
+	}
 
-		for (auto s = 0; s < size; ++s, ++seed)
-		{
-			mt.seed(seed);
-			noise[s] = dist(mt);
-		}
+	/* noise, size, seed, start. writes the noise of the indices [start, start + size[ */
+	inline void generateProceduralNoise(double* noise, int size, unsigned int seed, uint32_t start = 0) noexcept
+	{
+		for (auto s = 0; s < size; ++s)
+			noise[s] = hashNoise(seed, start + static_cast<uint32_t>(s));
 	}
 
 	inline double getInterpolatedNN(const double* noise, double phase) noexcept
@@ -91,33 +92,243 @@ namespace perlin
 
 	using PlayHeadPos = juce::AudioPlayHead::CurrentPositionInfo;
 	using InterpolationFunc = double(*)(const double*, double) noexcept;
-	using InterpolationFuncs = std::array<InterpolationFunc, 3>;
 	using SIMD = juce::FloatVectorOperations;
 
-	struct Perlin
+	enum class Shape
+	{
+		NN, Lerp, Spline, NumShapes
+	};
+
+	static constexpr int NumOctaves = 7;
+	static constexpr int NoiseSize = 1 << NumOctaves;
+	static constexpr int NoiseSizeMax = NoiseSize - 1;
+
+	/* phase, o. the phase of octave o, wrapped to the noise */
+	inline double getPhaseOctaved(double phase, int o) noexcept
+	{
+		const auto ox2 = 1 << o;
+		const auto oPhase = phase * static_cast<double>(ox2);
+		const auto oPhaseFloor = std::floor(oPhase);
+		const auto oPhaseInt = static_cast<int>(oPhaseFloor) & NoiseSizeMax;
+		return oPhase - oPhaseFloor + static_cast<double>(oPhaseInt);
+	}
+
+	/*
+	* the octaves summed up in advance, so n octaves cost one lookup instead of n interpolations.
+	* table n of a shape holds the first n octaves weighted by the gains, with 2^n cells per unit of phase.
+	* every step of nn, every knot of lerp and every knot of spline lies on that grid, so within a cell
+	* the sum is a constant (nn), a line (lerp) or a cubic (spline) and the tables reproduce it exactly.
+	* nn and lerp store one sample per cell, spline stores the 4 coefficients of each cell's cubic
+	*/
+	struct NoisePyramid
 	{
-		enum class Shape
+		static constexpr int NumShapes = static_cast<int>(Shape::NumShapes);
+		// nn and lerp tables get one wrapped sample at the end
+		static constexpr int NumGuards = 1;
+		static constexpr int NumCoefs = 4;
+
+		NoisePyramid() :
+			tables(),
+			offsets()
+		{
+			for (auto sh = 0; sh < NumShapes; ++sh)
+			{
+				const auto spline = static_cast<Shape>(sh) == Shape::Spline;
+				auto offset = 0;
+				for (auto n = 1; n <= NumOctaves; ++n)
+				{
+					offsets[sh][n] = offset;
+					offset += spline ? getSize(n) * NumCoefs : getSize(n) + NumGuards;
+				}
+				tables[sh].resize(offset, 0.);
+			}
+		}
+
+		/* noise, gains. evaluates every octave at every table point, so it belongs to seed changes */
+		void build(const double* noise, const double* gains)
+		{
+			for (auto n = 1; n <= NumOctaves; ++n)
+			{
+				const auto size = getSize(n);
+				const auto cellLength = 1. / static_cast<double>(1 << n);
+
+				// nn is constant within a cell, so it's sampled in the centre and looked up with floor
+				auto nn = getTable(n, Shape::NN);
+				auto lerp = getTable(n, Shape::Lerp);
+				for (auto i = 0; i < size; ++i)
+				{
+					const auto phase = static_cast<double>(i) * cellLength;
+					nn[i] = sum(&getInterpolatedNN, noise, gains, phase + cellLength * .5, n);
+					lerp[i] = sum(&getInterpolatedLerp, noise, gains, phase, n);
+				}
+				nn[size] = nn[0];
+				lerp[size] = lerp[0];
+
+				// 4 points determine the cubic of a cell. newton's forward differences in u = 3t
+				auto spline = getTable(n, Shape::Spline);
+				for (auto i = 0; i < size; ++i, spline += NumCoefs)
+				{
+					std::array<double, NumCoefs> y;
+					for (auto k = 0; k < NumCoefs; ++k)
+					{
+						const auto t = static_cast<double>(k) / 3.;
+						y[k] = sum(&getInterpolatedSpline, noise, gains, (static_cast<double>(i) + t) * cellLength, n);
+					}
+					const auto d1 = y[1] - y[0];
+					const auto d2 = y[2] - 2. * y[1] + y[0];
+					const auto d3 = y[3] - 3. * y[2] + 3. * y[1] - y[0];
+					spline[0] = y[0];
+					spline[1] = 3. * (d1 - d2 * .5 + d3 / 3.);
+					spline[2] = 9. * (d2 - d3) * .5;
+					spline[3] = 27. * d3 / 6.;
+				}
+			}
+		}
+
+		/* phase, numOctaves [1, NumOctaves] */
+		template<Shape S>
+		double lookup(double phase, int numOctaves) const noexcept
+		{
+			const auto table = getTable(numOctaves, S);
+			const auto x = wrap(phase, numOctaves);
+			if constexpr (S == Shape::NN)
+				return table[static_cast<int>(x)];
+			else if constexpr (S == Shape::Lerp)
+				return interpolation::lerp(table, x);
+			else
+				return evaluate(table, x);
+		}
+
+		/* phase, numOctaves [1, NumOctaves], shape */
+		double operator()(double phase, int numOctaves, Shape shape) const noexcept
+		{
+			switch (shape)
+			{
+			case Shape::NN: return lookup<Shape::NN>(phase, numOctaves);
+			case Shape::Lerp: return lookup<Shape::Lerp>(phase, numOctaves);
+			default: return lookup<Shape::Spline>(phase, numOctaves);
+			}
+		}
+
+		/* dest, phases, numOctaves [0, NumOctaves] per sample, shape, numSamples. 0 octaves are silent */
+		void operator()(double* dest, const double* phases, const int* numOctaves,
+			Shape shape, int numSamples) const noexcept
+		{
+			switch (shape)
+			{
+			case Shape::NN: return lookup<Shape::NN>(dest, phases, numOctaves, numSamples);
+			case Shape::Lerp: return lookup<Shape::Lerp>(dest, phases, numOctaves, numSamples);
+			default: return lookup<Shape::Spline>(dest, phases, numOctaves, numSamples);
+			}
+		}
+
+		/* dest, phases, scratch, numOctaves [1, NumOctaves], shape, numSamples. dest may be phases */
+		void operator()(double* dest, const double* phases, double* scratch,
+			int numOctaves, Shape shape, int numSamples) const noexcept
+		{
+			const auto table = getTable(numOctaves, shape);
+			for (auto s = 0; s < numSamples; ++s)
+				scratch[s] = wrap(phases[s], numOctaves);
+			switch (shape)
+			{
+			case Shape::NN:
+				for (auto s = 0; s < numSamples; ++s)
+					dest[s] = table[static_cast<int>(scratch[s])];
+				return;
+			case Shape::Lerp: return interpolation::lerp(dest, table, scratch, numSamples);
+			default:
+				for (auto s = 0; s < numSamples; ++s)
+					dest[s] = evaluate(table, scratch[s]);
+				return;
+			}
+		}
+
+	protected:
+		std::array<std::vector<double>, NumShapes> tables;
+		std::array<std::array<int, NumOctaves + 1>, NumShapes> offsets;
+
+		template<Shape S>
+		void lookup(double* dest, const double* phases, const int* numOctaves, int numSamples) const noexcept
+		{
+			for (auto s = 0; s < numSamples; ++s)
+				dest[s] = numOctaves[s] != 0 ? lookup<S>(phases[s], numOctaves[s]) : 0.;
+		}
+
+		static int getSize(int numOctaves) noexcept
+		{
+			return NoiseSize << numOctaves;
+		}
+
+		double* getTable(int numOctaves, Shape shape) noexcept
+		{
+			const auto sh = static_cast<int>(shape);
+			return &tables[sh][offsets[sh][numOctaves]];
+		}
+
+		const double* getTable(int numOctaves, Shape shape) const noexcept
+		{
+			const auto sh = static_cast<int>(shape);
+			return &tables[sh][offsets[sh][numOctaves]];
+		}
+
+		/* func, noise, gains, phase, numOctaves */
+		static double sum(InterpolationFunc func, const double* noise, const double* gains,
+			double phase, int numOctaves) noexcept
 		{
-			NN, Lerp, Spline, NumShapes
-		};
+			auto y = 0.;
+			for (auto o = 0; o < numOctaves; ++o)
+				y += func(noise, getPhaseOctaved(phase, o)) * gains[o];
+			return y;
+		}
+
+		/* coefs, x. horner on the cubic of cell floor(x) */
+		static double evaluate(const double* coefs, double x) noexcept
+		{
+			const auto xFloor = std::floor(x);
+			const auto c = coefs + static_cast<int>(xFloor) * NumCoefs;
+			const auto t = x - xFloor;
+			return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+		}
+
+		/* phase, numOctaves. the position in table numOctaves, wrapped to [0, size[ */
+		static double wrap(double phase, int numOctaves) noexcept
+		{
+			const auto x = phase * static_cast<double>(1 << numOctaves);
+			const auto xFloor = std::floor(x);
+			const auto i = static_cast<int>(xFloor) & (getSize(numOctaves) - 1);
+			return static_cast<double>(i) + (x - xFloor);
+		}
+	};
+
+	struct Perlin
+	{
+		using Shape = perlin::Shape;
 
-		static constexpr int NumOctaves = 7;
+		static constexpr int NumOctaves = perlin::NumOctaves;
 		static constexpr int NoiseOvershoot = 4;
 
-		static constexpr int NoiseSize = 1 << NumOctaves;
-		static constexpr int NoiseSizeMax = NoiseSize - 1;
+		static constexpr int NoiseSize = perlin::NoiseSize;
+		static constexpr int NoiseSizeMax = perlin::NoiseSizeMax;
 
 		using NoiseArray = std::array<double, NoiseSize + NoiseOvershoot>;
 		using GainBuffer = std::array<double, NumOctaves + 2>;
 
 		Perlin() :
 			// misc
-			interpolationFuncs{ &getInterpolatedNN, &getInterpolatedLerp, &getInterpolatedSpline },
 			sampleRateInv(1), sampleRate(1.),
 			// phase
 			phasor(),
 			phaseBuffer(),
-			noiseIdx(0)
+			octavePhaseBuffer(),
+			octaveBuffer(),
+			octaveFracBuffer(),
+			octaveIdxBuffer(),
+			nextPhaseBuffer(),
+			nextBuffer(),
+			blendBuffer(),
+			noiseIdx(0),
+			period(0),
+			blending(false)
 		{
 		}
 
@@ -127,14 +338,23 @@ namespace perlin
 			sampleRate = _sampleRate;
 			sampleRateInv = 1. / sampleRate;
 			phaseBuffer.resize(blockSize);
+			octavePhaseBuffer.resize(blockSize);
+			octaveBuffer.resize(blockSize);
+			octaveFracBuffer.resize(blockSize);
+			octaveIdxBuffer.resize(blockSize);
+			nextPhaseBuffer.resize(blockSize);
+			nextBuffer.resize(blockSize);
+			blendBuffer.resize(blockSize);
 		}
 
 		/* newPhase */
 		void updatePosition(double newPhase) noexcept
 		{
 			const auto newPhaseFloor = std::floor(newPhase);
+			const auto newPhaseInt = static_cast<juce::int64>(newPhaseFloor);
 
-			noiseIdx = static_cast<int>(newPhaseFloor) & NoiseSizeMax;
+			noiseIdx = static_cast<int>(newPhaseInt & NoiseSizeMax);
+			period = static_cast<uint32_t>(newPhaseInt >> NumOctaves);
 			phasor.phase.phase = newPhase - newPhaseFloor;
 		}
 
@@ -159,90 +379,140 @@ namespace perlin
 			updatePosition(timeHz);
 		}
 		
-		/* samples, noise, gainBuffer,
+		/* samples, noise, pyramid, gainBuffer, seed,
 		octavesInfo, phsInfo, widthInfo,
 		shape, numChannels, numSamples */
-		void operator()(double* const* samples, const double* noise, const double* gainBuffer,
+		void operator()(double* const* samples, const double* noise, const NoisePyramid& pyramid,
+			const double* gainBuffer, uint32_t seed,
 			const PRMInfo& octavesInfo, const PRMInfo& phsInfo, const PRMInfo& widthInfo,
 			Shape shape, int numChannels, int numSamples) noexcept
 		{
-			synthesizePhasor(phsInfo, numSamples);
+			synthesizePhasor(phsInfo, seed, numSamples);
 
-			processOctaves(samples[0], octavesInfo, noise, gainBuffer, shape, numSamples);
+			processOctaves(samples[0], octavesInfo, noise, pyramid, gainBuffer, shape, numSamples);
 
 			if (numChannels == 2)
-				processWidth(samples, octavesInfo, widthInfo, noise, gainBuffer, shape, numSamples);
+				processWidth(samples, octavesInfo, widthInfo, noise, pyramid, gainBuffer, shape, numSamples);
 		}
 
 		// misc
-		InterpolationFuncs interpolationFuncs;
 		double sampleRateInv, sampleRate;
 
 		// phase
 		PhasorD phasor;
 		std::vector<double> phaseBuffer;
+		// one octave at a time, so its interpolation runs over the whole block
+		std::vector<double> octavePhaseBuffer, octaveBuffer;
+		// the smoothed octaves split into their integer and fractional part
+		std::vector<double> octaveFracBuffer;
+		std::vector<int> octaveIdxBuffer;
+		// the last cell of a pass fades into the phases of the next pass
+		std::vector<double> nextPhaseBuffer, nextBuffer, blendBuffer;
 		int noiseIdx;
+		// counts the passes through the noise
+		uint32_t period;
+		bool blending;
 
 	protected:
-		/* phsInfo, numSamples */
-		void synthesizePhasor(const PRMInfo& phsInfo, int numSamples) noexcept
+		/*
+		* seed, pass. every pass through the noise starts at a rotation and runs forwards or backwards,
+		* both drawn from the hash of its period, so the sequence doesn't repeat every NoiseSize cells.
+		* returns the position in the noise of x [0, NoiseSize[ on that pass
+		*/
+		static double toNoise(double x, uint32_t seed, uint32_t pass) noexcept
 		{
-			if (!phsInfo.smoothing)
-				for (auto s = 0; s < numSamples; ++s)
+			// seed + 1 and seed + 2 are streams of their own, far away from the indices of the noise
+			const auto reversed = dsp::hashUnit(seed + 1u, pass) < .5;
+			const auto rotation = std::floor(dsp::hashUnit(seed + 2u, pass) * static_cast<double>(NoiseSize));
+			return rotation + (reversed ? static_cast<double>(NoiseSize) - x : x);
+		}
+
+		/* phsInfo, seed, numSamples */
+		void synthesizePhasor(const PRMInfo& phsInfo, uint32_t seed, int numSamples) noexcept
+		{
+			blending = false;
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				const auto phaseInfo = phasor();
+				if (phaseInfo.retrig)
 				{
-					const auto phaseInfo = phasor();
-					if (phaseInfo.retrig)
-						noiseIdx = (noiseIdx + 1) & NoiseSizeMax;
+					noiseIdx = (noiseIdx + 1) & NoiseSizeMax;
+					if (noiseIdx == 0)
+						++period;
+				}
 
-					phaseBuffer[s] = phaseInfo.phase + phsInfo.val + static_cast<double>(noiseIdx);
+				const auto x = phaseInfo.phase + static_cast<double>(noiseIdx);
+				phaseBuffer[s] = toNoise(x, seed, period);
+				if (noiseIdx != NoiseSizeMax)
+				{
+					nextPhaseBuffer[s] = phaseBuffer[s];
+					blendBuffer[s] = 0.;
 				}
-			else
-				for (auto s = 0; s < numSamples; ++s)
+				else
 				{
-					const auto phaseInfo = phasor();
-					if (phaseInfo.retrig)
-						noiseIdx = (noiseIdx + 1) & NoiseSizeMax;
-
-					phaseBuffer[s] = phaseInfo.phase + phsInfo[s] + static_cast<double>(noiseIdx);
+					// the passes start elsewhere in the noise, so the last cell fades into the next pass with a smoothstep
+					const auto t = phaseInfo.phase;
+					nextPhaseBuffer[s] = toNoise(x - static_cast<double>(NoiseSize), seed, period + 1u);
+					blendBuffer[s] = t * t * (3. - 2. * t);
+					blending = true;
 				}
+			}
+
+			// the phase offset is added after the mirroring, so it shifts both directions alike
+			if (!phsInfo.smoothing)
+			{
+				SIMD::add(phaseBuffer.data(), phsInfo.val, numSamples);
+				if (blending)
+					SIMD::add(nextPhaseBuffer.data(), phsInfo.val, numSamples);
+			}
+			else
+			{
+				SIMD::add(phaseBuffer.data(), phsInfo.buf, numSamples);
+				if (blending)
+					SIMD::add(nextPhaseBuffer.data(), phsInfo.buf, numSamples);
+			}
 		}
 
-		double getInterpolatedSample(const double* noise,
-			double phase, Shape shape) const noexcept
+		/* smpls, octavesInfo, noise, pyramid, gainBuffer, shape, numSamples */
+		void processOctaves(double* smpls, const PRMInfo& octavesInfo,
+			const double* noise, const NoisePyramid& pyramid, const double* gainBuffer,
+			Shape shape, int numSamples) noexcept
 		{
-			const auto smpl0 = interpolationFuncs[static_cast<int>(shape)](noise, phase);
-			return smpl0;
+			processOctavesPass(smpls, octavesInfo, noise, pyramid, gainBuffer, shape, numSamples);
+			if (!blending)
+				return;
+
+			std::swap(phaseBuffer, nextPhaseBuffer);
+			auto next = nextBuffer.data();
+			processOctavesPass(next, octavesInfo, noise, pyramid, gainBuffer, shape, numSamples);
+			std::swap(phaseBuffer, nextPhaseBuffer);
+			for (auto s = 0; s < numSamples; ++s)
+				smpls[s] += blendBuffer[s] * (next[s] - smpls[s]);
 		}
 
-		/* smpls, octavesInfo, noise, gainBuffer, shape, numSamples */
-		void processOctaves(double* smpls, const PRMInfo& octavesInfo,
-			const double* noise, const double* gainBuffer, Shape shape, int numSamples) noexcept
+		/* smpls, octavesInfo, noise, pyramid, gainBuffer, shape, numSamples. at the phases of phaseBuffer */
+		void processOctavesPass(double* smpls, const PRMInfo& octavesInfo,
+			const double* noise, const NoisePyramid& pyramid, const double* gainBuffer,
+			Shape shape, int numSamples) noexcept
 		{
 			if (!octavesInfo.smoothing)
-				processOctavesNotSmoothing(smpls, noise, gainBuffer, octavesInfo.val, shape, numSamples);
+				processOctavesNotSmoothing(smpls, noise, pyramid, gainBuffer, octavesInfo.val, shape, numSamples);
 			else
-				processOctavesSmoothing(smpls, octavesInfo.buf, noise, gainBuffer, shape, numSamples);
+				processOctavesSmoothing(smpls, octavesInfo.buf, noise, pyramid, gainBuffer, shape, numSamples);
 		}
 
 		
-		/* smpls, noise, gainBuffer, octaves, shape, numSamples */
-		void processOctavesNotSmoothing(double* smpls, const double* noise, const double* gainBuffer, double octaves,
-			Shape shape, int numSamples) noexcept
+		/* smpls, noise, pyramid, gainBuffer, octaves, shape, numSamples */
+		void processOctavesNotSmoothing(double* smpls, const double* noise, const NoisePyramid& pyramid,
+			const double* gainBuffer, double octaves, Shape shape, int numSamples) noexcept
 		{
 			const auto octFloor = std::floor(octaves);
+			auto octBuf = octaveBuffer.data();
 
-			for (auto s = 0; s < numSamples; ++s)
-			{
-				auto sample = 0.;
-				for (auto o = 0; o < octFloor; ++o)
-				{
-					const auto phase = getPhaseOctaved(phaseBuffer[s], o);
-					const auto smpl = getInterpolatedSample(noise, phase, shape);
-					sample += smpl * gainBuffer[o];
-				}
-
-				smpls[s] = sample;
-			}
+			if (octFloor >= 1.)
+				pyramid(smpls, phaseBuffer.data(), octavePhaseBuffer.data(), static_cast<int>(octFloor), shape, numSamples);
+			else
+				SIMD::clear(smpls, numSamples);
 
 			auto gain = 0.;
 			for (auto o = 0; o < octFloor; ++o)
@@ -253,12 +523,9 @@ namespace perlin
 			{
 				const auto octFloorInt = static_cast<int>(octFloor);
 
+				synthesizeOctave(octBuf, noise, octFloorInt, shape, numSamples);
 				for (auto s = 0; s < numSamples; ++s)
-				{
-					const auto phase = getPhaseOctaved(phaseBuffer[s], octFloorInt);
-					const auto smpl = getInterpolatedSample(noise, phase, shape);
-					smpls[s] += octFrac * smpl * gainBuffer[octFloorInt];;
-				}
+					smpls[s] += octFrac * octBuf[s] * gainBuffer[octFloorInt];
 
 				gain += octFrac * gainBuffer[octFloorInt];
 			}
@@ -266,68 +533,94 @@ namespace perlin
 			SIMD::multiply(smpls, 1. / std::sqrt(gain), numSamples);
 		}
 
-		/* smpls, octavesBuf, noise, gainBuffer, shape, numSamples */
+		/* smpls, octavesBuf, noise, pyramid, gainBuffer, shape, numSamples */
 		void processOctavesSmoothing(double* smpls, const double* octavesBuf,
-			const double* noise, const double* gainBuffer,
+			const double* noise, const NoisePyramid& pyramid, const double* gainBuffer,
 			Shape shape, int numSamples) noexcept
 		{
+			auto octIdx = octaveIdxBuffer.data();
+			auto octFrac = octaveFracBuffer.data();
+			auto octBuf = octaveBuffer.data();
+			auto phases = octavePhaseBuffer.data();
+
+			// gainSums[n] is the gain of the first n octaves
+			GainBuffer gainSums;
+			gainSums[0] = 0.;
+			for (auto o = 1; o < gainSums.size(); ++o)
+				gainSums[o] = gainSums[o - 1] + gainBuffer[o - 1];
+
 			for (auto s = 0; s < numSamples; ++s)
 			{
 				const auto octFloor = std::floor(octavesBuf[s]);
+				octIdx[s] = static_cast<int>(octFloor);
+				octFrac[s] = octavesBuf[s] - octFloor;
+			}
 
-				auto sample = 0.;
-				for (auto o = 0; o < octFloor; ++o)
-				{
-					const auto phase = getPhaseOctaved(phaseBuffer[s], o);
-					const auto smpl = getInterpolatedSample(noise, phase, shape);
-					sample += smpl * gainBuffer[o];
-				}
-
-				smpls[s] = sample;
-
-				auto gain = 0.;
-				for (auto o = 0; o < octFloor; ++o)
-					gain += gainBuffer[o];
-
-				const auto octFrac = octavesBuf[s] - octFloor;
-				if (octFrac != 0.)
-				{
-					const auto octFloorInt = static_cast<int>(octFloor);
-
-					const auto phase = getPhaseOctaved(phaseBuffer[s], octFloorInt);
-					const auto smpl = getInterpolatedSample(noise, phase, shape);
-					smpls[s] += octFrac * smpl * gainBuffer[octFloorInt];
+			pyramid(smpls, phaseBuffer.data(), octIdx, shape, numSamples);
 
-					gain += octFrac * gainBuffer[octFloorInt];
-				}
+			for (auto s = 0; s < numSamples; ++s)
+				phases[s] = getPhaseOctaved(phaseBuffer[s], octIdx[s]);
+			interpolateOctave(octBuf, noise, shape, numSamples);
 
-				smpls[s] /= std::sqrt(gain);
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				const auto o = octIdx[s];
+				const auto gain = gainSums[o] + octFrac[s] * gainBuffer[o];
+				smpls[s] = (smpls[s] + octFrac[s] * octBuf[s] * gainBuffer[o]) / std::sqrt(gain);
 			}
 		}
 
-		/* samples, octavesInfo, widthInfo, noise, gainBuffer, shape, numSamples */
+		/* samples, octavesInfo, widthInfo, noise, pyramid, gainBuffer, shape, numSamples */
 		void processWidth(double* const* samples, const PRMInfo& octavesInfo,
-			const PRMInfo& widthInfo, const double* noise, const double* gainBuffer,
-			Shape shape, int numSamples) noexcept
+			const PRMInfo& widthInfo, const double* noise, const NoisePyramid& pyramid,
+			const double* gainBuffer, Shape shape, int numSamples) noexcept
 		{
 			if (!widthInfo.smoothing)
 				if (widthInfo.val == 0.)
 					return SIMD::copy(samples[1], samples[0], numSamples);
 				else
+				{
 					SIMD::add(phaseBuffer.data(), widthInfo.val, numSamples);
+					if (blending)
+						SIMD::add(nextPhaseBuffer.data(), widthInfo.val, numSamples);
+				}
 			else
+			{
 				SIMD::add(phaseBuffer.data(), widthInfo.buf, numSamples);
+				if (blending)
+					SIMD::add(nextPhaseBuffer.data(), widthInfo.buf, numSamples);
+			}
+
+			processOctaves(samples[1], octavesInfo, noise, pyramid, gainBuffer, shape, numSamples);
+		}
+
+		/* dest, noise, o, shape, numSamples */
+		void synthesizeOctave(double* dest, const double* noise, int o, Shape shape, int numSamples) noexcept
+		{
+			auto phases = octavePhaseBuffer.data();
+			for (auto s = 0; s < numSamples; ++s)
+				phases[s] = getPhaseOctaved(phaseBuffer[s], o);
 
-			processOctaves(samples[1], octavesInfo, noise, gainBuffer, shape, numSamples);
+			interpolateOctave(dest, noise, shape, numSamples);
 		}
 
-		double getPhaseOctaved(double phaseInfo, int o) const noexcept
+		/* dest, noise, shape, numSamples. interpolates the noise at octavePhaseBuffer, which it may alter */
+		void interpolateOctave(double* dest, const double* noise, Shape shape, int numSamples) noexcept
 		{
-			const auto ox2 = 1 << o;
-			const auto oPhase = phaseInfo * static_cast<double>(ox2);
-			const auto oPhaseFloor = std::floor(oPhase);
-			const auto oPhaseInt = static_cast<int>(oPhaseFloor) & NoiseSizeMax;
-			return oPhase - oPhaseFloor + static_cast<double>(oPhaseInt);
+			auto phases = octavePhaseBuffer.data();
+			switch (shape)
+			{
+			case Shape::NN:
+				for (auto s = 0; s < numSamples; ++s)
+					dest[s] = getInterpolatedNN(noise, phases[s]);
+				return;
+			case Shape::Lerp:
+				for (auto s = 0; s < numSamples; ++s)
+					phases[s] += 1.5;
+				return interpolation::lerp(dest, noise, phases, numSamples);
+			default:
+				return interpolation::cubicHermiteSpline(dest, noise, phases, numSamples);
+			}
 		}
 
 		// debug:
@@ -356,7 +649,6 @@ namespace perlin
 	};
 
 	using AudioBuffer = juce::AudioBuffer<double>;
-	using Shape = Perlin::Shape;
 
 	struct Perlin2
 	{
@@ -368,6 +660,7 @@ namespace perlin
 			// noise
 			noise(),
 			gainBuffer(),
+			pyramid(),
 			// perlin
 			prevBuffer(),
 			perlins(),
@@ -379,6 +672,8 @@ namespace perlin
 			rateBeats(-1.),
 			rateHz(-1.),
 			rateInv(0.),
+			// bias
+			biasBuffer(),
 			// crossfade
 			xFadeBuffer(),
 			xPhase(0.),
@@ -386,25 +681,30 @@ namespace perlin
 			crossfading(false),
 			lastBlockWasTemposync(false),
 			seed(),
+			pyramidSeed(),
 			// project position
 			curPosEstimate(-1),
 			curPosInSamples(0),
 			latency(0)
 		{
-			juce::Random rand;
-			setSeed(rand.nextInt());
-
-			for (auto s = 0; s < Perlin::NoiseOvershoot; ++s)
-				noise[Perlin::NoiseSize + s] = noise[s];
-
 			for (auto o = 0; o < gainBuffer.size(); ++o)
 				gainBuffer[o] = 1. / static_cast<double>(1 << o);
+
+			juce::Random rand;
+			setSeed(rand.nextInt());
 		}
 
+		/* _seed. rebuilds the pyramid, so it belongs to patch loads */
 		void setSeed(int _seed)
 		{
+			if (pyramidSeed == _seed)
+				return;
+			pyramidSeed = _seed;
 			seed.store(_seed);
 			generateProceduralNoise(noise.data(), Perlin::NoiseSize, static_cast<unsigned int>(_seed));
+			for (auto s = 0; s < Perlin::NoiseOvershoot; ++s)
+				noise[Perlin::NoiseSize + s] = noise[s];
+			pyramid.build(noise.data(), gainBuffer.data());
 		}
 
 		void prepare(double fs, int blockSize, int _latency)
@@ -418,6 +718,7 @@ namespace perlin
 				perlin.prepare(fs, blockSize);
 			xInc = msInInc(420., fs);
 			xFadeBuffer.resize(blockSize);
+			biasBuffer.resize(blockSize);
 			octavesPRM.prepare(fs, blockSize, 10.);
 			widthPRM.prepare(fs, blockSize, 20.);
 			phsPRM.prepare(fs, blockSize, 20.);
@@ -447,7 +748,9 @@ namespace perlin
 			(
 				samples,
 				noise.data(),
+				pyramid,
 				gainBuffer.data(),
+				static_cast<uint32_t>(seed.load()),
 				octavesInfo,
 				phsInfo,
 				widthInfo,
@@ -469,20 +772,17 @@ namespace perlin
 
 			if(bias != 0.)
 				for(auto ch = 0; ch < numChannels; ++ch)
+				{
+					auto smpls = samples[ch];
+					auto y = biasBuffer.data();
+					dsp::shaping::perlinBias<double>(y, smpls, numSamples);
 					for (auto s = 0; s < numSamples; ++s)
 					{
-						auto x = samples[ch][s];
-						auto y = 1.;
-						if (x != 0.)
-						{
-							auto X = 8. * x * Pi;
-							auto A = 1. - abs(x);
-							y = approx::sin(X) * approx::sin(X) / X;
-							y = 1.5 * A * A * y;
-						}
-							
-						samples[ch][s] = x + bias * (y - x);
+						const auto x = smpls[s];
+						const auto yS = x != 0. ? y[s] : 1.;
+						smpls[s] = x + bias * (yS - x);
 					}
+				}
 		}
 
 		// misc
@@ -490,6 +790,7 @@ namespace perlin
 		// noise
 		Perlin::NoiseArray noise;
 		Perlin::GainBuffer gainBuffer;
+		NoisePyramid pyramid;
 		// perlin
 		AudioBuffer prevBuffer;
 		std::array<Perlin, 2> perlins;
@@ -498,12 +799,16 @@ namespace perlin
 		PRM octavesPRM, widthPRM, phsPRM;
 		double rateBeats, rateHz;
 		double rateInv;
+		// bias
+		std::vector<double> biasBuffer;
 		// crossfade
 		std::vector<double> xFadeBuffer;
 		double xPhase, xInc;
 		bool crossfading, lastBlockWasTemposync;
 		// seed
 		std::atomic<int> seed;
+		// the seed the noise and pyramid were built of
+		std::optional<int> pyramidSeed;
 		// project position
 		Int64 curPosEstimate, curPosInSamples;
 		int latency;
@@ -633,7 +938,9 @@ namespace perlin
 				(
 					prevSamples,
 					noise.data(),
+					pyramid,
 					gainBuffer.data(),
+					static_cast<uint32_t>(seed.load()),
 					octavesInfo,
 					phsInfo,
 					widthInfo,
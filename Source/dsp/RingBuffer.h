@@ -0,0 +1,105 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <algorithm>
+
+namespace dsp
+{
+	/* smallest power of 2 >= x */
+	inline int nextPowerOfTwo(int x) noexcept
+	{
+		auto p = 1;
+		while (p < x)
+			p <<= 1;
+		return p;
+	}
+
+	/*
+	* delay line storage with a power of 2 capacity, so indices wrap with a mask.
+	* NumGuards samples on both ends mirror the other end of the ring,
+	* so interpolators can read from i - NumGuards to i + NumGuards without wrapping.
+	*/
+	template<typename Float>
+	struct RingBuffer
+	{
+		static constexpr int NumGuards = 8;
+
+		/* minSize; the capacity every ring of that size gets, also needed for a matching WHead */
+		static int getCapacity(int minSize) noexcept
+		{
+			return nextPowerOfTwo(std::max(minSize, NumGuards * 2));
+		}
+
+		RingBuffer() :
+			buffer(),
+			capacity(0),
+			mask(0)
+		{}
+
+		/* numChannels, minSize */
+		void prepare(int numChannels, int minSize)
+		{
+			capacity = getCapacity(minSize);
+			mask = capacity - 1;
+			buffer.setSize(numChannels, capacity + NumGuards * 2, false, true, false);
+		}
+
+		void clear() noexcept
+		{
+			buffer.clear();
+		}
+
+		/* the ring of a channel, index 0 is the first non-guard sample */
+		Float* operator[](int ch) noexcept
+		{
+			return buffer.getWritePointer(ch) + NumGuards;
+		}
+
+		const Float* operator[](int ch) const noexcept
+		{
+			return buffer.getReadPointer(ch) + NumGuards;
+		}
+
+		/* ring, i [0, capacity), x. writes the sample and its mirror in the guards */
+		void write(Float* ring, int i, Float x) const noexcept
+		{
+			ring[i] = x;
+			if (i < NumGuards)
+				ring[i + capacity] = x;
+			else if (i >= capacity - NumGuards)
+				ring[i - capacity] = x;
+		}
+
+		/* ring, start [0, capacity), src, n [0, capacity]. writes a block that may wrap around the end */
+		void write(Float* ring, int start, const Float* src, int n) const noexcept
+		{
+			const auto n0 = std::min(n, capacity - start);
+			std::copy(src, src + n0, ring + start);
+			std::copy(src + n0, src + n, ring);
+			updateGuards(ring);
+		}
+
+		/* ring. mirrors both ends of the ring into the guards */
+		void updateGuards(Float* ring) const noexcept
+		{
+			for (auto i = 0; i < NumGuards; ++i)
+			{
+				ring[capacity + i] = ring[i];
+				ring[i - NumGuards] = ring[capacity - NumGuards + i];
+			}
+		}
+
+		int getCapacity() const noexcept
+		{
+			return capacity;
+		}
+
+		int getMask() const noexcept
+		{
+			return mask;
+		}
+
+	protected:
+		juce::AudioBuffer<Float> buffer;
+		int capacity, mask;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+#include <functional>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include "../Interpolation.h"
+
+namespace dsp
+{
+	/*
+	* a transfer curve sampled once, then linearly interpolated.
+	* the number of cells doubles until the interpolation stays within maxError of the curve,
+	* which is checked at several points per cell, so every table knows its error bound.
+	* inputs outside [xMin, xMax] are clamped, so curves should saturate or never leave the range
+	*/
+	template<typename Float>
+	struct ShapingTable
+	{
+		using Func = std::function<double(double)>;
+		static constexpr int MinNumCells = 1 << 8;
+		static constexpr int MaxNumCells = 1 << 16;
+		static constexpr int NumChecksPerCell = 8;
+
+		/* func, xMin, xMax, maxError */
+		ShapingTable(const Func& func, double _xMin, double _xMax, double maxError) :
+			table(),
+			xMin(static_cast<Float>(_xMin)),
+			scale(static_cast<Float>(0)),
+			posMax(static_cast<Float>(0)),
+			error(0.)
+		{
+			for (auto numCells = MinNumCells; numCells <= MaxNumCells; numCells *= 2)
+			{
+				fill(func, _xMin, _xMax, numCells);
+				error = measureError(func, _xMin, _xMax, numCells);
+				if (error <= maxError)
+					break;
+			}
+		}
+
+		/* x */
+		Float operator()(Float x) const noexcept
+		{
+			return interpolation::lerp(table.data(), getPosition(x));
+		}
+
+		/* dest, x, numSamples. dest may be x */
+		void operator()(Float* dest, const Float* x, int numSamples) const noexcept
+		{
+			for (auto s = 0; s < numSamples; ++s)
+				dest[s] = getPosition(x[s]);
+			interpolation::lerp(dest, table.data(), dest, numSamples);
+		}
+
+		/* the largest deviation from the curve found while building the table */
+		double getError() const noexcept
+		{
+			return error;
+		}
+
+	protected:
+		std::vector<Float> table;
+		Float xMin, scale, posMax;
+		double error;
+
+		Float getPosition(Float x) const noexcept
+		{
+			return std::min(std::max((x - xMin) * scale, static_cast<Float>(0)), posMax);
+		}
+
+		void fill(const Func& func, double _xMin, double _xMax, int numCells)
+		{
+			const auto cellLength = (_xMax - _xMin) / static_cast<double>(numCells);
+			scale = static_cast<Float>(1. / cellLength);
+			posMax = static_cast<Float>(numCells);
+			// one more knot than cells and a guard, so lerp at posMax stays inside
+			table.resize(numCells + 2);
+			for (auto i = 0; i <= numCells; ++i)
+				table[i] = static_cast<Float>(func(_xMin + static_cast<double>(i) * cellLength));
+			table[numCells + 1] = table[numCells];
+		}
+
+		double measureError(const Func& func, double _xMin, double _xMax, int numCells) const
+		{
+			const auto numChecks = numCells * NumChecksPerCell;
+			const auto checkLength = (_xMax - _xMin) / static_cast<double>(numChecks);
+			auto maxError = 0.;
+			for (auto i = 0; i < numChecks; ++i)
+			{
+				// between the knots, where lerp is furthest from them
+				const auto x = _xMin + (static_cast<double>(i) + .5) * checkLength;
+				const auto y = static_cast<double>(operator()(static_cast<Float>(x)));
+				maxError = std::max(maxError, std::abs(y - func(x)));
+			}
+			return maxError;
+		}
+	};
+
+	/* the curves shared by every instance of the plugin */
+	namespace shaping
+	{
+		static constexpr double MaxError = 1e-5;
+
+		/* perlin bias: 1.5 * (1 - |x|)^2 * sin(8 pi x)^2 / (8 pi x). the caller handles x == 0 */
+		template<typename Float>
+		inline const ShapingTable<Float> perlinBias([](double x)
+		{
+			if (x == 0.)
+				return 0.;
+			const auto X = 8. * x * 3.1415926535897932384626433832795;
+			const auto A = 1. - std::abs(x);
+			const auto sinX = std::sin(X);
+			return 1.5 * A * A * sinX * sinX / X;
+		}, -1., 1., MaxError);
+
+		/* tanh(8 * x^15), saturated beyond +-1.2 */
+		template<typename Float>
+		inline const ShapingTable<Float> tanhX15([](double x)
+		{
+			const auto X = 2. * x * x * x * x * x;
+			return std::tanh(X * X * X);
+		}, -1.5, 1.5, MaxError);
+
+		/* approx::tanh(pi / 2 * x^3), the dropout envelope that never leaves [-1, 1] */
+		template<typename Float>
+		inline const ShapingTable<Float> dropout([](double x)
+		{
+			const auto X = 1.5707963267948966192313216916398 * x * x * x;
+			const auto XX = X * X;
+			return X * (27. + XX) / (27. + 9. * XX);
+		}, -1.5, 1.5, MaxError);
+
+		/* cos(tau * x) for phases in [0, 1]. tighter, because it drives audio rate modulation */
+		template<typename Float>
+		inline const ShapingTable<Float> cosine([](double x)
+		{
+			return std::cos(6.283185307179586476925286766559 * x);
+		}, 0., 1., 1e-6);
+	}
+}
\ No newline at end of file
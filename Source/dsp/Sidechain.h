@@ -4,9 +4,10 @@
 
 namespace dsp
 {
+	template<typename Float>
 	struct Sidechain
 	{
-		using AudioBufferD = juce::AudioBuffer<double>;
+		using AudioBuffer = juce::AudioBuffer<Float>;
 		using AudioProcessor = juce::AudioProcessor;
 		using Bus = AudioProcessor::Bus;
 		using ChannelSet = juce::AudioChannelSet;
@@ -32,7 +33,7 @@ namespace dsp
 			enabled(false)
 		{}
 
-		void updateBuffers(AudioProcessor& p, AudioBufferD& buffer, bool standalone) noexcept
+		void updateBuffers(AudioProcessor& p, AudioBuffer& buffer, bool standalone) noexcept
 		{
 			busMain = p.getBus(true, 0);
 			bufferMain = busMain->getBusBuffer(buffer);
@@ -62,7 +63,7 @@ namespace dsp
 			enabled = false;
 		}
 
-		void setBufferUpsampled(AudioBufferD* _bufferUpsampled) noexcept
+		void setBufferUpsampled(AudioBuffer* _bufferUpsampled) noexcept
 		{
 			bufferUpsampled = _bufferUpsampled;
 			bufferMainUpsampled = busMain->getBusBuffer(*bufferUpsampled);
@@ -81,15 +82,15 @@ namespace dsp
 		}
 
 		Bus *busMain, *busSC;
-		AudioBufferD bufferMain, bufferSC, *bufferUpsampled, bufferMainUpsampled, bufferSCUpsampled;
-		double* const* samplesMain;
-		const double* const* samplesMainRead;
-		double* const* samplesSC;
-		const double* const* samplesSCRead;
-		double* const* samplesMainUpsampled;
-		const double* const* samplesMainReadUpsampled;
-		double* const* samplesSCUpsampled;
-		const double* const* samplesSCReadUpsampled;
+		AudioBuffer bufferMain, bufferSC, *bufferUpsampled, bufferMainUpsampled, bufferSCUpsampled;
+		Float* const* samplesMain;
+		const Float* const* samplesMainRead;
+		Float* const* samplesSC;
+		const Float* const* samplesSCRead;
+		Float* const* samplesMainUpsampled;
+		const Float* const* samplesMainReadUpsampled;
+		Float* const* samplesSCUpsampled;
+		const Float* const* samplesSCReadUpsampled;
 		int numChannels, numChannelsSC;
 		bool enabled;
 	};
@@ -127,15 +127,26 @@ namespace smooth
 	template<typename Float>
 	void Lowpass<Float>::operator()(Float* buffer, Float val, int numSamples) noexcept
 	{
+		// the state stays in a register, because buffer could alias it
+		auto y = y1;
 		for (auto s = 0; s < numSamples; ++s)
-			buffer[s] = processSample(val);
+		{
+			y = val * a0 + y * b1;
+			buffer[s] = y;
+		}
+		y1 = y;
 	}
 
 	template<typename Float>
 	void Lowpass<Float>::operator()(Float* buffer, int numSamples) noexcept
 	{
+		auto y = y1;
 		for (auto s = 0; s < numSamples; ++s)
-			buffer[s] = processSample(buffer[s]);
+		{
+			y = buffer[s] * a0 + y * b1;
+			buffer[s] = y;
+		}
+		y1 = y;
 	}
 
 	template<typename Float>
@@ -2,7 +2,12 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <array>
 #include <limits>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
 #include "WHead.h"
+#include "RingBuffer.h"
+#include "../Interpolation.h"
 #include "PRM.h"
 
 namespace vibrato
@@ -10,15 +15,11 @@ namespace vibrato
 	//static constexpr double Pi = 3.1415926535897932384626433832795;
 	//static constexpr double PiHalf = Pi / 2.;
 
-	using AudioBufferD = juce::AudioBuffer<double>;
 	using WHead = dsp::WHead;
 	using PRMInfo = dsp::PRMInfo<double>;
 	using PRM = dsp::PRM<double>;
-	using LP = smooth::Lowpass<double>;
-
-	/* buffer, x, size */
-	using InterpolationFunc = double(*)(const double*, double, int) noexcept;
-	using FilterUpdateFunc = void(*)(LP&, double dampFc) noexcept;
+	template<typename Float>
+	using LP = smooth::Lowpass<Float>;
 
 	template<typename Float>
 	inline Float fastTanh2(Float x) noexcept
@@ -43,7 +44,7 @@ namespace vibrato
 
 	enum class InterpolationType
 	{
-		Lerp, Spline,
+		Lerp, Spline, Lagrange4, Lagrange6, Sinc8, Sinc16,
 		NumInterpolationTypes
 	};
 	
@@ -53,8 +54,10 @@ namespace vibrato
 		{
 		case InterpolationType::Lerp: return "lerp";
 		case InterpolationType::Spline: return "spline";
-		//case InterpolationType::LagRange: return "lagrange";
-		//case InterpolationType::Sinc: return "sinc";
+		case InterpolationType::Lagrange4: return "lagrange4";
+		case InterpolationType::Lagrange6: return "lagrange6";
+		case InterpolationType::Sinc8: return "sinc8";
+		case InterpolationType::Sinc16: return "sinc16";
 		default: return "";
 		}
 	}
@@ -71,196 +74,700 @@ namespace vibrato
 		return InterpolationType::NumInterpolationTypes;
 	}
 
-	inline double lerp(const double* buffer, double x, int size) noexcept
+	/* the read head stays double, so long delays don't lose precision in float.
+	the guard samples of the ring make wrapping unnecessary */
+	template<typename Float>
+	inline Float lerp(const Float* buffer, double x) noexcept
 	{
-		return interpolation::lerp(buffer, x, size);
+		return interpolation::lerp(buffer, x);
 	}
 
-	inline double cubic(const double* buffer, double x, int size) noexcept
+	template<typename Float>
+	inline Float cubic(const Float* buffer, double x) noexcept
 	{
-		return interpolation::cubicHermiteSpline(buffer, x, size);
+		return interpolation::cubicHermiteSpline(buffer - 1, x);
 	}
 
-	inline void noUpdate(LP&, double) noexcept {} // yes, this is important
+	/* resolved at compile time, so the kernels below inline the interpolator */
+	template<InterpolationType Type, typename Float>
+	inline Float interpolate(const Float* ring, double x) noexcept
+	{
+		if constexpr (Type == InterpolationType::Lerp)
+			return lerp(ring, x);
+		else if constexpr (Type == InterpolationType::Spline)
+			return cubic(ring, x);
+		else if constexpr (Type == InterpolationType::Lagrange4)
+			return interpolation::lagrange4<Float>(ring, x);
+		else if constexpr (Type == InterpolationType::Lagrange6)
+			return interpolation::lagrange6<Float>(ring, x);
+		else if constexpr (Type == InterpolationType::Sinc8)
+			return interpolation::sinc8<Float>(ring, x);
+		else
+			return interpolation::sinc16<Float>(ring, x);
+	}
 
-	inline void updateFilter(LP& lp, double dampFc) noexcept
+	/* dest, ring, x, numSamples. the block version of interpolate, lerp and spline gather several heads at once */
+	template<InterpolationType Type, typename Float>
+	inline void interpolate(Float* dest, const Float* ring, const double* x, int numSamples) noexcept
 	{
-		lp.makeFromDecayInFc(dampFc);
+		if constexpr (Type == InterpolationType::Lerp)
+			interpolation::lerp(dest, ring, x, numSamples);
+		else if constexpr (Type == InterpolationType::Spline)
+			interpolation::cubicHermiteSpline(dest, ring - 1, x, numSamples);
+		else
+			for (auto s = 0; s < numSamples; ++s)
+				dest[s] = interpolate<Type>(ring, x[s]);
 	}
 
-	inline double waveshape(double x) noexcept
+	/* ring0, ring1, x. both channels read at the same head, so the fraction and the coefficients are computed once */
+	template<InterpolationType Type, typename Float>
+	inline std::array<Float, 2> interpolateLinked(const Float* ring0, const Float* ring1, double x) noexcept
+	{
+		if constexpr (Type == InterpolationType::Lerp)
+			return interpolation::lerp(ring0, ring1, x);
+		else if constexpr (Type == InterpolationType::Spline)
+			return interpolation::cubicHermiteSpline(ring0 - 1, ring1 - 1, x);
+		else if constexpr (Type == InterpolationType::Lagrange4)
+			return interpolation::lagrange4<Float>(ring0, ring1, x);
+		else if constexpr (Type == InterpolationType::Lagrange6)
+			return interpolation::lagrange6<Float>(ring0, ring1, x);
+		else if constexpr (Type == InterpolationType::Sinc8)
+			return interpolation::sinc8<Float>(ring0, ring1, x);
+		else
+			return interpolation::sinc16<Float>(ring0, ring1, x);
+	}
+
+	template<typename Float>
+	inline void updateFilter(LP<Float>& lp, double dampFc) noexcept
 	{
-		return -.405548 * x * x * x + 1.34908 * x;
+		lp.makeFromDecayInFc(static_cast<Float>(dampFc));
 	}
 
+	template<typename Float>
+	inline Float waveshape(Float x) noexcept
+	{
+		return static_cast<Float>(-.405548) * x * x * x + static_cast<Float>(1.34908) * x;
+	}
+
+	template<typename Float>
 	struct SamplePair
 	{
-		double sIn, sOut;
+		Float sIn, sOut;
 	};
 
-	inline SamplePair getDelayPair(double* smpls, const double* ring, const InterpolationFunc& interpolate,
-		LP& lp, double r, double feedback, int size, int s) noexcept
+	template<InterpolationType Type, typename Float>
+	inline SamplePair<Float> getDelayPair(Float* smpls, const Float* ring,
+		LP<Float>& lp, double r, Float feedback, int s) noexcept
 	{
-		const auto sOut = interpolate(ring, r, size);
+		const auto sOut = interpolate<Type>(ring, r);
 		const auto sLP = lp(sOut);
 		const auto sFb = waveshape(feedback * sLP);
 		const auto sIn = smpls[s] + sFb;
 		return { sIn, sOut };
 	}
 	
-	inline SamplePair getAllpassPair(double*, const double*, const InterpolationFunc&,
-		double, double, int, int) noexcept
+	template<InterpolationType Type, typename Float>
+	inline SamplePair<Float> getAllpassPair(Float*, const Float*,
+		double, Float, int) noexcept
+	{
+		return { static_cast<Float>(0), static_cast<Float>(0) };
+	}
+
+	/* calls func with the interpolation type as a compile time constant */
+	template<typename Func>
+	inline void withInterpolationType(InterpolationType type, Func&& func)
+	{
+		using Type = InterpolationType;
+		switch (type)
+		{
+		case Type::Lerp: return func(std::integral_constant<Type, Type::Lerp>());
+		case Type::Lagrange4: return func(std::integral_constant<Type, Type::Lagrange4>());
+		case Type::Lagrange6: return func(std::integral_constant<Type, Type::Lagrange6>());
+		case Type::Sinc8: return func(std::integral_constant<Type, Type::Sinc8>());
+		case Type::Sinc16: return func(std::integral_constant<Type, Type::Sinc16>());
+		default: return func(std::integral_constant<Type, Type::Spline>());
+		}
+	}
+
+	/* samples a kernel reads past the read head */
+	template<InterpolationType Type>
+	static constexpr int Ahead =
+		Type == InterpolationType::Lerp ? 1 :
+		Type == InterpolationType::Spline ? 2 :
+		Type == InterpolationType::Lagrange4 ? std::decay_t<decltype(interpolation::lagrange4<double>)>::Ahead :
+		Type == InterpolationType::Lagrange6 ? std::decay_t<decltype(interpolation::lagrange6<double>)>::Ahead :
+		Type == InterpolationType::Sinc8 ? std::decay_t<decltype(interpolation::sinc8<double>)>::Ahead :
+		std::decay_t<decltype(interpolation::sinc16<double>)>::Ahead;
+
+	/* type. the read head stays this far behind the write head, so everything the kernel reads is written already */
+	inline double getMinDelay(InterpolationType type) noexcept
 	{
-		return { 0.f, 0.f };
+		auto minDelay = 0.;
+		withInterpolationType(type, [&](auto t)
+		{
+			minDelay = static_cast<double>(Ahead<decltype(t)::value> + 1);
+		});
+		return minDelay;
 	}
 
+	/* the range the read heads of a delay of a given size move in */
+	struct ReadRange
+	{
+		/* s, minDelay */
+		ReadRange(int s = 0, double _minDelay = 2.) :
+			size(static_cast<double>(s)),
+			mid(size * .5),
+			max(size - _minDelay * 2.),
+			minDelay(_minDelay)
+		{}
+
+		double size, mid, max, minDelay;
+	};
+
+	static constexpr int MaxNumVoices = 8;
+
+	/*
+	* size and voices of a delay. every voice reads the same ring with its own read head.
+	* voice v follows the modulation with alternating polarity, scaled down by spread,
+	* and gets an offset that spreads the voices evenly across the range
+	*/
+	struct Layout
+	{
+		/* size, _numVoices [1, MaxNumVoices], _spread [0, 1], _minDelay (getMinDelay of the interpolation type) */
+		Layout(int size = 0, int _numVoices = 1, double _spread = 0., double _minDelay = 2.) :
+			range(size, _minDelay),
+			scale(),
+			offset(),
+			gain(1. / static_cast<double>(_numVoices)),
+			spread(_spread),
+			minDelay(_minDelay),
+			numVoices(_numVoices),
+			sizeInt(size)
+		{
+			const auto halfMax = range.max * .5;
+			for (auto v = 0; v < numVoices; ++v)
+			{
+				const auto polarity = v % 2 == 0 ? 1. : -1.;
+				const auto o = numVoices == 1 ? 0. : 2. * static_cast<double>(v) / static_cast<double>(numVoices - 1) - 1.;
+				// map [-1, 1] to [mid - max / 2, mid + max / 2]
+				scale[v] = polarity * (1. - spread) * halfMax;
+				offset[v] = spread * o * halfMax + range.mid;
+			}
+		}
+
+		bool operator!=(const Layout& other) const noexcept
+		{
+			return sizeInt != other.sizeInt || numVoices != other.numVoices || spread != other.spread
+				|| minDelay != other.minDelay;
+		}
+
+		ReadRange range;
+		std::array<double, MaxNumVoices> scale, offset;
+		double gain, spread, minDelay;
+		int numVoices, sizeInt;
+	};
+
+	/* read head buffers of all channels and voices, [ch * MaxNumVoices + v] */
+	using Heads = std::array<const double*, 2 * MaxNumVoices>;
+
+	/* ring, heads (of one channel), numVoices, gain, s */
+	template<InterpolationType Type, typename Float>
+	inline Float readVoices(const Float* ring, const double* const* heads, int numVoices, Float gain, int s) noexcept
+	{
+		if (numVoices == 1)
+			return interpolate<Type>(ring, heads[0][s]);
+		// the voices don't depend on each other, so their reads overlap
+		auto y = static_cast<Float>(0);
+		for (auto v = 0; v < numVoices; ++v)
+			y += interpolate<Type>(ring, heads[v][s]);
+		return y * gain;
+	}
+
+	/* dest, scratch, ring, heads (of one channel), numVoices, gain, numSamples */
+	template<InterpolationType Type, typename Float>
+	inline void readVoices(Float* dest, Float* scratch, const Float* ring, const double* const* heads,
+		int numVoices, Float gain, int numSamples) noexcept
+	{
+		interpolate<Type>(dest, ring, heads[0], numSamples);
+		if (numVoices == 1)
+			return;
+		for (auto v = 1; v < numVoices; ++v)
+		{
+			interpolate<Type>(scratch, ring, heads[v], numSamples);
+			for (auto s = 0; s < numSamples; ++s)
+				dest[s] += scratch[s];
+		}
+		for (auto s = 0; s < numSamples; ++s)
+			dest[s] *= gain;
+	}
+
+	/* ring0, ring1, heads (shared by both channels), numVoices, gain, s */
+	template<InterpolationType Type, typename Float>
+	inline std::array<Float, 2> readVoicesLinked(const Float* ring0, const Float* ring1,
+		const double* const* heads, int numVoices, Float gain, int s) noexcept
+	{
+		if (numVoices == 1)
+			return interpolateLinked<Type>(ring0, ring1, heads[0][s]);
+		std::array<Float, 2> y = { static_cast<Float>(0), static_cast<Float>(0) };
+		for (auto v = 0; v < numVoices; ++v)
+		{
+			const auto yV = interpolateLinked<Type>(ring0, ring1, heads[v][s]);
+			y[0] += yV[0];
+			y[1] += yV[1];
+		}
+		return { y[0] * gain, y[1] * gain };
+	}
+
+	/*
+	* audio in Float, read heads and modulation in double.
+	* the ring is allocated for the largest size once. changes of the size or the voices
+	* crossfade between the read heads of the old and the new layout, so they can happen on the audio thread
+	*/
+	template<typename Float>
 	struct Delay
 	{
 		Delay() :
-			interpolationFuncs{ &lerp, &cubic },
-			filterUpdateFuncs{ &noUpdate, &updateFilter },
+			lps(),
 			ringBuffer(),
-			delaySize(0.), delayMid(0.), delayMax(0.),
-			delaySizeInt(0)
+			headBufs(),
+			fadeBuf(),
+			scratchBuf(),
+			layout(), layoutNext(), layoutTarget(),
+			capacity(0.),
+			fadeIdx(-1), fadeLength(1)
 		{
 		}
 
-		void prepare(int s)
+		/*
+		* s, maxSize, blockSize, _fadeLength (samples)
+		* the ring gets RingBuffer::getCapacity(maxSize + blockSize) samples, the wHead must use that capacity too.
+		* the extra block lets the feedback-free paths write a whole block before they read from it
+		*/
+		void prepare(int s, int maxSize, int blockSize, int _fadeLength)
 		{
-			delaySizeInt = s;
-			ringBuffer.setSize(2, delaySizeInt, false, true, false);
-			delaySize = static_cast<double>(delaySizeInt);
-			delayMax = delaySize - 4.;
-			delayMid = delaySize * .5;
+			ringBuffer.prepare(2, maxSize + blockSize);
+			capacity = static_cast<double>(ringBuffer.getCapacity());
+			for (auto& h : headBufs)
+				h.resize(blockSize);
+			fadeBuf.resize(blockSize);
+			scratchBuf.resize(blockSize);
+			fadeLength = std::max(_fadeLength, 1);
+
+			layout = layoutNext = layoutTarget = Layout(s, layoutTarget.numVoices, layoutTarget.spread, layoutTarget.minDelay);
+			fadeIdx = -1;
 		}
 
-		void operator()(double* const* samples, int numChannels, int numSamples,
-			double* const* vibBuf, const int* wHead, const double* fbBuf, const PRMInfo& dampFcInfo,
-			InterpolationType interpolationType) noexcept
+		/* s [getMinDelay(interpolationType) * 2, maxSize]. takes effect with the next block */
+		void setSize(int s) noexcept
 		{
-			synthesizeReadHead(numChannels, numSamples, vibBuf, wHead);
-			
-			auto ringBuf = ringBuffer.getArrayOfWritePointers();
-			const auto& interpolate = interpolationFuncs[static_cast<int>(interpolationType)];
-			const auto& updateFilter = filterUpdateFuncs[dampFcInfo.smoothing ? 1 : 0];
+			if (s != layoutTarget.sizeInt)
+				layoutTarget = Layout(s, layoutTarget.numVoices, layoutTarget.spread, layoutTarget.minDelay);
+		}
+
+		/* numVoices [1, MaxNumVoices], spread [0, 1]. takes effect with the next block */
+		void setVoices(int numVoices, double spread) noexcept
+		{
+			if (numVoices != layoutTarget.numVoices || spread != layoutTarget.spread)
+				layoutTarget = Layout(layoutTarget.sizeInt, numVoices, spread, layoutTarget.minDelay);
+		}
+
+		/* type. narrows the range to what the kernel needs, takes effect with the next block */
+		void setInterpolationType(InterpolationType type) noexcept
+		{
+			const auto minDelay = getMinDelay(type);
+			if (minDelay != layoutTarget.minDelay)
+				layoutTarget = Layout(layoutTarget.sizeInt, layoutTarget.numVoices, layoutTarget.spread, minDelay);
+		}
+
+		/* clears the ring buffer and the damping filters. no allocation */
+		void reset() noexcept
+		{
+			ringBuffer.clear();
+			// only the state, the cutoff is only updated while the damping parameter moves
+			for (auto& lp : lps)
+				lp.y1 = static_cast<Float>(0);
+		}
+
+		/*
+		* samples, numChannels, numSamples, vibBuf, wHead, fbInfo (buf filled), dampFcInfo, interpolationType,
+		* linked (both channels of vibBuf are identical)
+		*/
+		void operator()(Float* const* samples, int numChannels, int numSamples,
+			double* const* vibBuf, const int* wHead, const PRMInfo& fbInfo, const PRMInfo& dampFcInfo,
+			InterpolationType interpolationType, bool linked) noexcept
+		{
+			setInterpolationType(interpolationType);
+			beginBlock(numSamples);
+			const auto fading = isFading();
+			linked = linked && numChannels == 2;
+			// linked channels share the read heads of the left one
+			const auto numChannelsHeads = linked ? 1 : numChannels;
+			Heads heads, headsNext;
+			if (fading)
+				synthesizeVoices(headsNext, MaxNumVoices * 2, vibBuf, numChannelsHeads, numSamples, wHead, layoutNext);
+			synthesizeVoices(heads, 0, vibBuf, numChannelsHeads, numSamples, wHead, layout);
+			if (linked)
+				for (auto v = 0; v < MaxNumVoices; ++v)
+				{
+					heads[MaxNumVoices + v] = heads[v];
+					headsNext[MaxNumVoices + v] = headsNext[v];
+				}
+
+			withInterpolationType(interpolationType, [&](auto type)
+			{
+				dispatch<decltype(type)::value>(samples, numChannels, numSamples, heads, headsNext, wHead, fbInfo, dampFcInfo, linked);
+			});
+			endBlock(numSamples);
+		}
+
+		/* the read head sits on the write head, so the samples only have to be remembered */
+		void processNoDepth(Float* const* samples, int numChannels, int numSamples,
+			const int* wHead) noexcept
+		{
+			// the layout doesn't matter without depth, so it can jump
+			fadeIdx = -1;
+			layout = layoutTarget;
 
 			for (auto ch = 0; ch < numChannels; ++ch)
+				ringBuffer.write(ringBuffer[ch], wHead[0], samples[ch], numSamples);
+		}
+		
+		void processFF(Float* const* samples, int numChannels, int numSamples,
+			double* depthBuf, const int* wHead,
+			InterpolationType interpolationType) noexcept
+		{
+			setInterpolationType(interpolationType);
+			beginBlock(numSamples);
+			const auto fading = isFading();
+			auto depthNext = headBufs[0].data();
+			if (fading)
 			{
-				auto ring = ringBuf[ch];
-				const auto rHead = vibBuf[ch];
-				auto smpls = samples[ch];
-				auto& lp = lps[ch];
+				std::copy(depthBuf, depthBuf + numSamples, depthNext);
+				synthesizeReadHeadFF(numSamples, depthNext, wHead, layoutNext.range);
+			}
+			synthesizeReadHeadFF(numSamples, depthBuf, wHead, layout.range);
+			Heads heads, headsNext;
+			heads[0] = heads[MaxNumVoices] = depthBuf;
+			headsNext[0] = headsNext[MaxNumVoices] = depthNext;
+
+			// the depth is the same for both channels, so they are always linked
+			const auto linked = numChannels == 2;
+			withInterpolationType(interpolationType, [&](auto type)
+			{
+				static constexpr auto Type = decltype(type)::value;
+				if (fading)
+					processNoFeedback<Type, true>(samples, numChannels, numSamples, heads, headsNext, 1, 1, wHead, linked);
+				else
+					processNoFeedback<Type, false>(samples, numChannels, numSamples, heads, headsNext, 1, 1, wHead, linked);
+			});
+			endBlock(numSamples);
+		}
 
-				for (auto s = 0; s < numSamples; ++s)
+	private:
+		std::array<LP<Float>, 2> lps;
+		dsp::RingBuffer<Float> ringBuffer;
+		// read heads of every voice of both layouts
+		std::array<std::vector<double>, 4 * MaxNumVoices> headBufs;
+		std::vector<double> fadeBuf;
+		std::vector<Float> scratchBuf;
+		Layout layout, layoutNext, layoutTarget;
+		double capacity;
+		int fadeIdx, fadeLength;
+
+		bool isFading() const noexcept
+		{
+			return fadeIdx >= 0;
+		}
+
+		/* starts a fade if the layout changed and fills fadeBuf while fading */
+		void beginBlock(int numSamples) noexcept
+		{
+			if (!isFading() && layoutTarget != layout)
+			{
+				layoutNext = layoutTarget;
+				fadeIdx = 0;
+			}
+			if (!isFading())
+				return;
+
+			static constexpr double PiD = 3.1415926535897932384626433832795;
+			const auto fadeLengthInv = 1. / static_cast<double>(fadeLength);
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				const auto x = std::min(static_cast<double>(fadeIdx + s) * fadeLengthInv, 1.);
+				fadeBuf[s] = .5 - .5 * std::cos(x * PiD);
+			}
+		}
+
+		void endBlock(int numSamples) noexcept
+		{
+			if (!isFading())
+				return;
+			fadeIdx += numSamples;
+			if (fadeIdx < fadeLength)
+				return;
+			layout = layoutNext;
+			fadeIdx = -1;
+		}
+
+		/*
+		* heads, bufOffset (into headBufs), vibBuf [-1, 1], numChannels, numSamples, wHead, l
+		* a single voice maps vibBuf in place, more voices get their own buffers
+		*/
+		void synthesizeVoices(Heads& heads, int bufOffset, double* const* vibBuf,
+			int numChannels, int numSamples, const int* wHead, const Layout& l) noexcept
+		{
+			const auto inPlace = l.numVoices == 1 && bufOffset == 0;
+			for (auto ch = 0; ch < numChannels; ++ch)
+				for (auto v = 0; v < l.numVoices; ++v)
 				{
-					updateFilter(lp, dampFcInfo[s]);
-					
-					const auto w = wHead[s];
-					const auto r = rHead[s];
-					const auto fb = fbBuf[s];
+					const auto i = ch * MaxNumVoices + v;
+					const auto dest = inPlace ? vibBuf[ch] : headBufs[bufOffset + i].data();
+					synthesizeReadHead(dest, vibBuf[ch], numSamples, wHead, l.scale[v], l.offset[v]);
+					heads[i] = dest;
+				}
+		}
 
-					const auto pair = getDelayPair(smpls, ring, interpolate, lp, r, -fb, delaySizeInt, s);
+		/* picks the kernel once per block, so nothing in the sample loop goes through a pointer */
+		template<InterpolationType Type>
+		void dispatch(Float* const* samples, int numChannels, int numSamples,
+			const Heads& heads, const Heads& headsNext, const int* wHead,
+			const PRMInfo& fbInfo, const PRMInfo& dampFcInfo, bool linked) noexcept
+		{
+			const auto feedbackEnabled = fbInfo.smoothing || fbInfo.val != 0.;
+			const auto fading = isFading();
+			const auto numVoices = layout.numVoices;
+			const auto numVoicesNext = layoutNext.numVoices;
 
-					ring[w] = pair.sIn;
-					smpls[s] = pair.sOut;
+			if (!feedbackEnabled)
+			{
+				if (fading)
+					processNoFeedback<Type, true>(samples, numChannels, numSamples, heads, headsNext, numVoices, numVoicesNext, wHead, linked);
+				else
+					processNoFeedback<Type, false>(samples, numChannels, numSamples, heads, headsNext, numVoices, numVoicesNext, wHead, linked);
+				// the damping filter is skipped, but it must be ready once the feedback comes back
+				for (auto ch = 0; ch < numChannels; ++ch)
+				{
+					if (dampFcInfo.smoothing)
+						updateFilter(lps[ch], dampFcInfo[numSamples - 1]);
+					lps[ch].y1 = samples[ch][numSamples - 1];
 				}
 			}
+			else if (linked)
+			{
+				if (fading)
+				{
+					if (dampFcInfo.smoothing)
+						processLinked<Type, true, true>(samples, numSamples, heads, headsNext, wHead, fbInfo.buf, dampFcInfo);
+					else
+						processLinked<Type, false, true>(samples, numSamples, heads, headsNext, wHead, fbInfo.buf, dampFcInfo);
+				}
+				else if (dampFcInfo.smoothing)
+					processLinked<Type, true, false>(samples, numSamples, heads, headsNext, wHead, fbInfo.buf, dampFcInfo);
+				else
+					processLinked<Type, false, false>(samples, numSamples, heads, headsNext, wHead, fbInfo.buf, dampFcInfo);
+			}
+			else if (fading)
+			{
+				if (dampFcInfo.smoothing)
+					process<Type, true, true>(samples, numChannels, numSamples, heads, headsNext, wHead, fbInfo.buf, dampFcInfo);
+				else
+					process<Type, false, true>(samples, numChannels, numSamples, heads, headsNext, wHead, fbInfo.buf, dampFcInfo);
+			}
+			else if (dampFcInfo.smoothing)
+				process<Type, true, false>(samples, numChannels, numSamples, heads, headsNext, wHead, fbInfo.buf, dampFcInfo);
+			else
+				process<Type, false, false>(samples, numChannels, numSamples, heads, headsNext, wHead, fbInfo.buf, dampFcInfo);
 		}
 
-		void processNoDepth(double* const* samples, int numChannels, int numSamples,
-			const int* wHead) noexcept
+		/* while fading, the read heads of the old layout fade out and the ones of the new layout fade in */
+		template<InterpolationType Type, bool DampSmoothing, bool Fading>
+		void process(Float* const* samples, int numChannels, int numSamples,
+			const Heads& heads, const Heads& headsNext, const int* wHead,
+			const double* fbBuf, const PRMInfo& dampFcInfo) noexcept
 		{
-			auto ringBuf = ringBuffer.getArrayOfWritePointers();
+			const auto numVoices = layout.numVoices;
+			const auto numVoicesNext = layoutNext.numVoices;
+			const auto gain = static_cast<Float>(layout.gain);
+			const auto gainNext = static_cast<Float>(layoutNext.gain);
 
 			for (auto ch = 0; ch < numChannels; ++ch)
 			{
-				auto ring = ringBuf[ch];
+				auto ring = ringBuffer[ch];
+				const auto h = &heads[ch * MaxNumVoices];
+				const auto hNext = &headsNext[ch * MaxNumVoices];
 				auto smpls = samples[ch];
+				auto& lp = lps[ch];
 
 				for (auto s = 0; s < numSamples; ++s)
 				{
-					const auto w = wHead[s];
-					const auto r = w;
+					if constexpr (DampSmoothing)
+						updateFilter(lp, dampFcInfo[s]);
+
+					auto sOut = readVoices<Type>(ring, h, numVoices, gain, s);
+					if constexpr (Fading)
+					{
+						const auto sNext = readVoices<Type>(ring, hNext, numVoicesNext, gainNext, s);
+						sOut += static_cast<Float>(fadeBuf[s]) * (sNext - sOut);
+					}
+					const auto sLP = lp(sOut);
+					const auto sFb = waveshape(-static_cast<Float>(fbBuf[s]) * sLP);
+
+					ringBuffer.write(ring, wHead[s], smpls[s] + sFb);
+					smpls[s] = sOut;
+				}
+			}
+		}
 
-					ring[w] = smpls[s];
-					smpls[s] = ring[r];
+		/* stereo with the read heads of the left channel, both channels advance in the same sample loop */
+		template<InterpolationType Type, bool DampSmoothing, bool Fading>
+		void processLinked(Float* const* samples, int numSamples,
+			const Heads& heads, const Heads& headsNext, const int* wHead,
+			const double* fbBuf, const PRMInfo& dampFcInfo) noexcept
+		{
+			const auto numVoices = layout.numVoices;
+			const auto numVoicesNext = layoutNext.numVoices;
+			const auto gain = static_cast<Float>(layout.gain);
+			const auto gainNext = static_cast<Float>(layoutNext.gain);
+			auto ring0 = ringBuffer[0];
+			auto ring1 = ringBuffer[1];
+			const auto h = heads.data();
+			const auto hNext = headsNext.data();
+
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				if constexpr (DampSmoothing)
+				{
+					updateFilter(lps[0], dampFcInfo[s]);
+					updateFilter(lps[1], dampFcInfo[s]);
 				}
+
+				auto sOut = readVoicesLinked<Type>(ring0, ring1, h, numVoices, gain, s);
+				if constexpr (Fading)
+				{
+					const auto sNext = readVoicesLinked<Type>(ring0, ring1, hNext, numVoicesNext, gainNext, s);
+					const auto fade = static_cast<Float>(fadeBuf[s]);
+					sOut[0] += fade * (sNext[0] - sOut[0]);
+					sOut[1] += fade * (sNext[1] - sOut[1]);
+				}
+				const auto fb = -static_cast<Float>(fbBuf[s]);
+				const auto sFb0 = waveshape(fb * lps[0](sOut[0]));
+				const auto sFb1 = waveshape(fb * lps[1](sOut[1]));
+
+				ringBuffer.write(ring0, wHead[s], samples[0][s] + sFb0);
+				ringBuffer.write(ring1, wHead[s], samples[1][s] + sFb1);
+				samples[0][s] = sOut[0];
+				samples[1][s] = sOut[1];
 			}
 		}
-		
-		void processFF(double* const* samples, int numChannels, int numSamples,
-			double* depthBuf, const int* wHead,
-			InterpolationType interpolationType) noexcept
+
+		/*
+		* without feedback no read depends on a write of the same block,
+		* so the block is written first and the reads form one loop without a carried dependency.
+		* the read heads stay getMinDelay samples behind the write head, so every sample a kernel reads
+		* belongs to this block or an earlier one, never to the previous lap of the ring
+		*/
+		template<InterpolationType Type, bool Fading>
+		void processNoFeedback(Float* const* samples, int numChannels, int numSamples,
+			const Heads& heads, const Heads& headsNext, int numVoices, int numVoicesNext, const int* wHead,
+			bool linked) noexcept
 		{
-			synthesizeReadHeadFF(numSamples, depthBuf, wHead);
+			const auto gain = static_cast<Float>(1. / static_cast<double>(numVoices));
+			const auto gainNext = static_cast<Float>(1. / static_cast<double>(numVoicesNext));
 
-			auto ringBuf = ringBuffer.getArrayOfWritePointers();
-			const auto& interpolate = interpolationFuncs[static_cast<int>(interpolationType)];
+			// lerp and spline gain more from gathering whole blocks than from sharing the fraction between channels
+			static constexpr bool GatherBlock = Type == InterpolationType::Lerp || Type == InterpolationType::Spline;
+			if (!Fading && (GatherBlock || !linked))
+			{
+				for (auto ch = 0; ch < numChannels; ++ch)
+				{
+					auto ring = ringBuffer[ch];
+					ringBuffer.write(ring, wHead[0], samples[ch], numSamples);
+					readVoices<Type>(samples[ch], scratchBuf.data(), ring, &heads[ch * MaxNumVoices], numVoices, gain, numSamples);
+				}
+				return;
+			}
+
+			if (linked)
+			{
+				// linked stereo reads both rings at the left channel's heads in one loop
+				auto ring0 = ringBuffer[0];
+				auto ring1 = ringBuffer[1];
+				ringBuffer.write(ring0, wHead[0], samples[0], numSamples);
+				ringBuffer.write(ring1, wHead[0], samples[1], numSamples);
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					auto y = readVoicesLinked<Type>(ring0, ring1, heads.data(), numVoices, gain, s);
+					if constexpr (Fading)
+					{
+						const auto yNext = readVoicesLinked<Type>(ring0, ring1, headsNext.data(), numVoicesNext, gainNext, s);
+						const auto fade = static_cast<Float>(fadeBuf[s]);
+						y[0] += fade * (yNext[0] - y[0]);
+						y[1] += fade * (yNext[1] - y[1]);
+					}
+					samples[0][s] = y[0];
+					samples[1][s] = y[1];
+				}
+				return;
+			}
 
 			for (auto ch = 0; ch < numChannels; ++ch)
 			{
-				auto ring = ringBuf[ch];
+				auto ring = ringBuffer[ch];
+				const auto h = &heads[ch * MaxNumVoices];
+				const auto hNext = &headsNext[ch * MaxNumVoices];
 				auto smpls = samples[ch];
 
+				ringBuffer.write(ring, wHead[0], smpls, numSamples);
 				for (auto s = 0; s < numSamples; ++s)
 				{
-					const auto w = wHead[s];
-					const auto r = depthBuf[s];
-
-					ring[w] = smpls[s];
-					smpls[s] = interpolate(ring, r, delaySizeInt);
+					auto y = readVoices<Type>(ring, h, numVoices, gain, s);
+					if constexpr (Fading)
+					{
+						const auto yNext = readVoices<Type>(ring, hNext, numVoicesNext, gainNext, s);
+						y += static_cast<Float>(fadeBuf[s]) * (yNext - y);
+					}
+					smpls[s] = y;
 				}
 			}
 		}
 
-	private:
-		std::array<InterpolationFunc, 2> interpolationFuncs;
-		std::array<FilterUpdateFunc, 2> filterUpdateFuncs;
-		std::array<LP, 2> lps;
-		AudioBufferD ringBuffer;
-		double delaySize, delayMid, delayMax;
-		int delaySizeInt;
-
-		void synthesizeReadHead(int numChannels, int numSamples, double* const* vibBuf, const int* wHead) noexcept
+		/* dest, src [-1, 1], numSamples, wHead, scale, offset. dest may be src */
+		void synthesizeReadHead(double* dest, const double* src, int numSamples, const int* wHead,
+			double scale, double offset) noexcept
 		{
-			for (auto ch = 0; ch < numChannels; ++ch)
-			{
-				auto buf = vibBuf[ch];
-				// map buffer [-1, 1] to [-delayMax, delayMax]
-				juce::FloatVectorOperations::multiply(buf, delayMax, numSamples);
-				// map buffer [-delayMax, delayMax] to [0, delaySize]
-				juce::FloatVectorOperations::add(buf, delaySize, numSamples);
-				// map buffer [0, delayMax * 2] to [0, delayMax]
-				juce::FloatVectorOperations::multiply(buf, .5, numSamples);
-
-				synthesizeReadHead(buf, numSamples, wHead);
-			}
+			for (auto s = 0; s < numSamples; ++s)
+				dest[s] = src[s] * scale + offset;
+
+			toReadHead(dest, numSamples, wHead);
 		}
 
-		void synthesizeReadHeadFF(int numSamples, double* depthBuf, const int* wHead) noexcept
+		/* depthBuf [0, 1] -> read heads, numSamples, wHead, range */
+		void synthesizeReadHeadFF(int numSamples, double* depthBuf, const int* wHead, const ReadRange& r) noexcept
 		{
-			// map from [0, 1] to [1, 0]
+			// map from [0, 1] to [mid, minDelay], so the kernel never reads past the write head
+			const auto scale = r.mid - r.minDelay;
 			for (auto s = 0; s < numSamples; ++s)
-				depthBuf[s] = 1. - depthBuf[s];
-			// map from [1, 0] to [delayMid, 0]
-			juce::FloatVectorOperations::multiply(depthBuf, delayMid, numSamples);
-			synthesizeReadHead(depthBuf, numSamples, wHead);
+				depthBuf[s] = r.minDelay + (1. - depthBuf[s]) * scale;
+			toReadHead(depthBuf, numSamples, wHead);
 		}
 
-		void synthesizeReadHead(double* buf, int numSamples, const int* wHead) noexcept
+		/* buf (delay in samples -> read head), numSamples, wHead */
+		void toReadHead(double* buf, int numSamples, const int* wHead) noexcept
 		{
 			for (auto s = 0; s < numSamples; ++s)
 			{
 				const auto dly = buf[s];
 				auto rh = static_cast<double>(wHead[s]) - dly;
 				if (rh < 0.)
-					rh += delaySize;
+					rh += capacity;
 
 				buf[s] = rh;
 			}
 		}
 	};
 
+	template<typename Float>
 	struct Processor
 	{
 		Processor() :
@@ -274,22 +781,49 @@ namespace vibrato
 		{
 		}
 		
-		void prepare(double Fs, int blockSize, int _delaySize)
+		/* Fs, blockSize, _delaySize, maxDelaySize (setSize can go up to it without allocating) */
+		void prepare(double Fs, int blockSize, int _delaySize, int maxDelaySize)
 		{
 			size = _delaySize;
-			wHead.prepare(blockSize, size);
-			vibrato.prepare(size);
-			delayFF.prepare(size);
+			maxDelaySize = std::max(maxDelaySize, size);
+			wHead.prepare(blockSize, dsp::RingBuffer<Float>::getCapacity(maxDelaySize + blockSize));
+			const auto fadeLength = static_cast<int>(std::round(Fs * .02));
+			vibrato.prepare(size, maxDelaySize, blockSize, fadeLength);
+			delayFF.prepare(size, maxDelaySize, blockSize, fadeLength);
 			feedbackPRM.prepare(Fs, blockSize, 8.);
 			dampPRM.prepare(Fs, blockSize, 13.);
 
 			fsInv = 1. / Fs;
 		}
 
-		/* samples, numChannels, numSamples, vibBuf, depthBuf[0,1], feedback[-1,1], dampHz[1, N], lookaheadEnabled */
-		void operator()(double* const* samples, int numChannels, int numSamples,
+		/* _delaySize [0, maxDelaySize]. crossfades to the new size on the audio thread */
+		void setSize(int _delaySize) noexcept
+		{
+			size = _delaySize;
+			vibrato.setSize(size);
+			delayFF.setSize(size);
+		}
+
+		/* numVoices [1, MaxNumVoices], spread [0, 1]. all voices share the write head and the ring */
+		void setVoices(int numVoices, double spread) noexcept
+		{
+			vibrato.setVoices(numVoices, spread);
+		}
+
+		/* forgets the signal in the delay lines, e.g. before a path switch warms this processor up */
+		void reset() noexcept
+		{
+			vibrato.reset();
+			delayFF.reset();
+		}
+
+		/*
+		* samples, numChannels, numSamples, vibBuf, depthBuf[0,1], feedback[-1,1], dampHz[1, N], interpolationType,
+		* lookaheadEnabled, modsLinked (both channels of vibBuf are identical)
+		*/
+		void operator()(Float* const* samples, int numChannels, int numSamples,
 			double* const* vibBuf, double* depthBuf, double feedback, double dampHz, InterpolationType interpolationType,
-			bool lookaheadEnabled) noexcept
+			bool lookaheadEnabled, bool modsLinked) noexcept
 		{
 			wHead(numSamples);
 			
@@ -309,8 +843,9 @@ namespace vibrato
 					samples, numChannels, numSamples,
 					vibBuf,
 					wHead.data(),
-					fbInfo.buf, dampInfo,
-					interpolationType
+					fbInfo, dampInfo,
+					interpolationType,
+					modsLinked
 				);
 			}
 			else
@@ -343,7 +878,7 @@ namespace vibrato
 	protected:
 		PRM feedbackPRM, dampPRM;
 		WHead wHead;
-		Delay vibrato, delayFF;
+		Delay<Float> vibrato, delayFF;
 		double fsInv;
 		int size;
 		
@@ -3,27 +3,31 @@
 
 namespace dsp
 {
+	/* write head of a ring with a power of 2 size (see RingBuffer::getCapacity) */
 	struct WHead
 	{
 		WHead() :
 			buf(),
 			wHead(0),
-			delaySize(1)
+			delaySize(1),
+			mask(0)
 		{}
 
+		/* blockSize, delaySize (power of 2) */
 		void prepare(int blockSize, int _delaySize)
 		{
 			delaySize = _delaySize;
 			if (delaySize != 0)
 			{
-				wHead = wHead % delaySize;
+				mask = delaySize - 1;
+				wHead = wHead & mask;
 				buf.resize(blockSize);
 			}
 		}
 
 		void operator()(int numSamples) noexcept
 		{
-			for (auto s = 0; s < numSamples; ++s, wHead = (wHead + 1) % delaySize)
+			for (auto s = 0; s < numSamples; ++s, wHead = (wHead + 1) & mask)
 				buf[s] = wHead;
 		}
 
@@ -45,17 +49,11 @@ namespace dsp
 		void shift(int shift, int numSamples) noexcept
 		{
 			for (auto s = 0; s < numSamples; ++s)
-			{
-				buf[s] = buf[s] + shift;
-				if (buf[s] > delaySize)
-					buf[s] -= delaySize;
-				else if (buf[s] < 0)
-					buf[s] += delaySize;
-			}
+				buf[s] = (buf[s] + shift) & mask;
 			wHead = buf[numSamples - 1];
 		}
-		
+
 		std::vector<int> buf;
-		int wHead, delaySize;
+		int wHead, delaySize, mask;
 	};
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include <juce_core/juce_core.h>
 #include <functional>
+#include <algorithm>
+#include <array>
+#include "../Interpolation.h"
 
 namespace dsp
 {
@@ -134,6 +137,15 @@ namespace dsp
 			return table[idx];
 		}
 
+		/* dest, x, numSamples. the block version of operator[](Float), dest may be x */
+		void operator()(Float* dest, const Float* x, int numSamples) const noexcept
+		{
+			static constexpr Float SizeF = static_cast<Float>(Size);
+			for (auto s = 0; s < numSamples; ++s)
+				dest[s] = x[s] * SizeF;
+			interpolation::lerp(dest, table.data(), dest, numSamples);
+		}
+
 	protected:
 		std::array<Float, Size + 2> table;
 	};
@@ -197,6 +209,27 @@ namespace dsp
 			return v0 + frac * (v1 - v0);
 		}
 
+		/* dest, tablesPhase, tablePhase, numSamples. the block version of operator()(Float, Float), dest may be tablePhase */
+		void operator()(Float* dest, Float tablesPhase, const Float* tablePhase, int numSamples) const noexcept
+		{
+			static constexpr int ChunkSize = 32;
+			const auto x = tablesPhase * MaxTablesF;
+			const auto xFloor = std::floor(x);
+			const auto i0 = static_cast<int>(xFloor);
+			const auto i1 = i0 + 1;
+			const auto frac = x - xFloor;
+
+			std::array<Float, ChunkSize> v0, v1;
+			for (auto s = 0; s < numSamples; s += ChunkSize)
+			{
+				const auto n = std::min(ChunkSize, numSamples - s);
+				tables[i0](v0.data(), tablePhase + s, n);
+				tables[i1](v1.data(), tablePhase + s, n);
+				for (auto i = 0; i < n; ++i)
+					dest[s + i] = v0[i] + frac * (v1[i] - v0[i]);
+			}
+		}
+
 		Table& operator[](int i) noexcept { return tables[i]; }
 
 		const Table& operator[](int i) const noexcept { return tables[i]; }
@@ -275,6 +308,12 @@ namespace dsp
 			return tables(tablesIdx, tableIdx);
 		}
 
+		/* dest, tablesPhase, tablePhase, numSamples. dest may be tablePhase */
+		void operator()(Float* dest, Float tablesPhase, const Float* tablePhase, int numSamples) const noexcept
+		{
+			tables(dest, tablesPhase, tablePhase, numSamples);
+		}
+
 		Table tables;
 		String name;
 	};
@@ -1,6 +1,8 @@
 #pragma once
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <array>
+#include <vector>
+#include <cmath>
 
 namespace dsp
 {
@@ -102,6 +104,106 @@ namespace dsp
         bool fading;
     };
 
+    /*
+    * switches between two processing paths (e.g. 1x and oversampled) without a gap.
+    * the new path is warmed up first, so its delay lines hold the recent signal,
+    * then both paths are crossfaded with a cosine curve.
+    * while switching both paths have to be processed, otherwise only the current one.
+    */
+    template<typename Float>
+    struct PathSwitch
+    {
+        static constexpr Float Pi = static_cast<Float>(3.1415926535897932384626433832795);
+
+        PathSwitch() :
+            xBuf(),
+            phase(static_cast<Float>(0)),
+            inc(static_cast<Float>(0)),
+            path(0),
+            target(0),
+            warmUpLength(0),
+            warmUpLeft(0)
+        {}
+
+        /* sampleRate, fadeLengthMs, warmUpLength (samples), blockSize, path */
+        void prepare(double sampleRate, double fadeLengthMs, int _warmUpLength, int blockSize, int _path)
+        {
+            xBuf.resize(blockSize);
+            inc = static_cast<Float>(msInInc(fadeLengthMs, sampleRate));
+            warmUpLength = _warmUpLength;
+            path = target = _path;
+            warmUpLeft = 0;
+            phase = static_cast<Float>(0);
+        }
+
+        /* requests a path. ignored while switching, the caller requests it again next block */
+        bool setPath(int p) noexcept
+        {
+            if (isSwitching() || p == path)
+                return false;
+            target = p;
+            warmUpLeft = warmUpLength;
+            phase = static_cast<Float>(0);
+            return true;
+        }
+
+        bool isSwitching() const noexcept
+        {
+            return path != target;
+        }
+
+        /* the path that is (mostly) audible */
+        int getPath() const noexcept
+        {
+            return path;
+        }
+
+        int getTarget() const noexcept
+        {
+            return target;
+        }
+
+        /* samples1 (output of path 1, gets the mix), samples0 (output of path 0), numChannels, numSamples */
+        void operator()(Float* const* samples1, const Float* const* samples0, int numChannels, int numSamples) noexcept
+        {
+            synthesizeGain(numSamples);
+
+            for (auto ch = 0; ch < numChannels; ++ch)
+            {
+                auto smpls1 = samples1[ch];
+                const auto smpls0 = samples0[ch];
+                for (auto s = 0; s < numSamples; ++s)
+                    smpls1[s] = smpls0[s] + xBuf[s] * (smpls1[s] - smpls0[s]);
+            }
+
+            if (warmUpLeft == 0 && phase >= static_cast<Float>(1))
+                path = target;
+        }
+
+    protected:
+        std::vector<Float> xBuf;
+        Float phase, inc;
+        int path, target, warmUpLength, warmUpLeft;
+
+        /* fills xBuf with the gain of path 1 */
+        void synthesizeGain(int numSamples) noexcept
+        {
+            for (auto s = 0; s < numSamples; ++s)
+            {
+                if (warmUpLeft != 0)
+                    --warmUpLeft;
+                else if (phase < static_cast<Float>(1))
+                {
+                    phase += inc;
+                    if (phase > static_cast<Float>(1))
+                        phase = static_cast<Float>(1);
+                }
+                const auto x = static_cast<Float>(.5) - static_cast<Float>(.5) * std::cos(phase * Pi);
+                xBuf[s] = target == 1 ? x : static_cast<Float>(1) - x;
+            }
+        }
+    };
+
     template<size_t NumTracks, bool Smooth>
     struct XFadeMixer
     {
@@ -66,7 +66,7 @@ namespace modSys6
 		Pitchbend1Smooth,
 		LFO1FreeSync, LFO1RateFree, LFO1RateSync, LFO1Waveform, LFO1Phase, LFO1Width,
 
-		Depth, ModsMix, DryWetMix, WetGain, StereoConfig, Feedback, Damp, HQ, Lookahead, BufferSize,
+		Depth, ModsMix, DryWetMix, WetGain, StereoConfig, Feedback, Damp, HQ, Lookahead, BufferSize, OversamplingFactor, OversamplingLowLatency, Voices, VoicesSpread,
 
 		NumParams
 	};
@@ -170,6 +170,10 @@ namespace modSys6
 		case PID::HQ: return "HQ";
 		case PID::Lookahead: return "Lookahead";
 		case PID::BufferSize: return "BufferSize";
+		case PID::OversamplingFactor: return "OversamplingFactor";
+		case PID::OversamplingLowLatency: return "OversamplingLowLatency";
+		case PID::Voices: return "Voices";
+		case PID::VoicesSpread: return "Voices Spread";
 
 		default: return "";
 		}
@@ -1118,18 +1122,63 @@ namespace modSys6
 			ValToStrFunc valToStrHQ = [](float v)
 			{
 				return v < .5f ? juce::String("1x") :
-					juce::String("4x");
+					juce::String("HQ");
 			};
 			StrToValFunc strToValHQ = [parse](const String& str)
 			{
 				const auto text = str.toLowerCase();
 				if (text == "1x" || text == "1" || text == "low" || text == "lo" || text == "off" || text == "false")
 					return 0.f;
-				else if (text == "4x" || text == "4" || text == "high" || text == "hi" || text == "420")
+				else if (text == "hq" || text == "4x" || text == "4" || text == "high" || text == "hi" || text == "on" || text == "420")
 					return 1.f;
 
 				return 1.f;
 			};
+
+			ValToStrFunc valToStrOversamplingFactor = [](float v)
+			{
+				const auto idx = static_cast<int>(std::round(v));
+				switch (idx)
+				{
+				case 1: return juce::String("2x");
+				case 2: return juce::String("4x");
+				case 3: return juce::String("8x");
+				case 4: return juce::String("4x FIR");
+				default: return juce::String("Auto");
+				}
+			};
+			StrToValFunc strToValOversamplingFactor = [parse](const String& str)
+			{
+				const auto text = str.toLowerCase();
+				if (text == "auto" || text == "a")
+					return 0.f;
+				else if (text == "2x" || text == "2")
+					return 1.f;
+				else if (text == "4x" || text == "4")
+					return 2.f;
+				else if (text == "8x" || text == "8")
+					return 3.f;
+				else if (text == "4x fir" || text == "fir")
+					return 4.f;
+
+				return 0.f;
+			};
+
+			ValToStrFunc valToStrOversamplingLowLatency = [](float v)
+			{
+				return v < .5f ? juce::String("Lin Phase") :
+					juce::String("Low Lat");
+			};
+			StrToValFunc strToValOversamplingLowLatency = [parse](const String& str)
+			{
+				const auto text = str.toLowerCase();
+				if (text == "lin phase" || text == "linear phase" || text == "linear" || text == "lin" || text == "0")
+					return 0.f;
+				else if (text == "low lat" || text == "low latency" || text == "low" || text == "iir" || text == "1")
+					return 1.f;
+
+				return 0.f;
+			};
 			
 			ValToStrFunc valToStrLookahead = [](float v)
 			{
@@ -1147,6 +1196,16 @@ namespace modSys6
 				return 1.f;
 			};
 
+			ValToStrFunc valToStrVoices = [](float v)
+			{
+				return String(std::round(v)) + (v < 1.5f ? " voice" : " voices");
+			};
+			StrToValFunc strToValVoices = [parse](const String& str)
+			{
+				const auto text = str.toLowerCase().trimCharactersAtEnd(" voices");
+				return std::round(parse(text, 1.f));
+			};
+
 			ValToStrFunc valToStrBufferSize = [](float v)
 			{
 				if(v < 1000.f)
@@ -1234,6 +1293,10 @@ namespace modSys6
 			params.push_back(new Param(PID::HQ, makeRange::toggle(), 1.f, valToStrHQ, strToValHQ, Unit::Power));
 			params.push_back(new Param(PID::Lookahead, makeRange::toggle(), 1.f, valToStrLookahead, strToValLookahead, Unit::Power));
 			params.push_back(new Param(PID::BufferSize, makeRange::bufferSizes({1.f, 4.f, 12.f, 24.f, 69.f, 420.f, 2000.f}), 4.f, valToStrBufferSize, strToValBufferSize));
+			params.push_back(new Param(PID::OversamplingFactor, makeRange::stepped(0.f, 4.f), 0.f, valToStrOversamplingFactor, strToValOversamplingFactor));
+			params.push_back(new Param(PID::OversamplingLowLatency, makeRange::toggle(), 0.f, valToStrOversamplingLowLatency, strToValOversamplingLowLatency));
+			params.push_back(new Param(PID::Voices, makeRange::stepped(1.f, 8.f), 1.f, valToStrVoices, strToValVoices));
+			params.push_back(new Param(PID::VoicesSpread, makeRange::lin(0.f, 1.f), .5f, valToStrPercent, strToValPercent, Unit::Percent));
 
 			for (auto param : params)
 				audioProcessor.addParameter(param);
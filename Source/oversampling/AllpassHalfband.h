@@ -0,0 +1,263 @@
+#pragma once
+#include "Filter.h"
+#include <array>
+#include <vector>
+#include <cmath>
+
+namespace oversampling
+{
+	/*
+	* polyphase iir halfband lowpass made of two parallel chains of first order allpasses
+	* (at the lower rate), after Valenzuela & Constantinides.
+	* H(z) = .5 * (A0(z^2) + z^-1 * A1(z^2))
+	* the phase isn't linear, but the group delay is only a few samples
+	* and every allpass costs a single multiply.
+	*/
+
+	template<typename Float>
+	struct AllpassHalfbandKernel
+	{
+		/* attenuationDb (stopband), transition (width of the transition band normalised to the higher rate, ]0, .5[) */
+		AllpassHalfbandKernel(Float attenuationDb = static_cast<Float>(90), Float transition = static_cast<Float>(.05)) :
+			coefs0(),
+			coefs1(),
+			latency(0)
+		{
+			const auto kq = getTransitionParams(static_cast<double>(transition));
+			const auto numCoefs = getNumCoefs(static_cast<double>(attenuationDb), kq[1]);
+			const auto order = numCoefs * 2 + 1;
+			for (auto i = 0; i < numCoefs; ++i)
+			{
+				const auto c = static_cast<Float>(getCoef(i, kq[0], kq[1], order));
+				if (i % 2 == 0)
+					coefs0.push_back(c);
+				else
+					coefs1.push_back(c);
+			}
+			latency = static_cast<int>(std::round(getGroupDelayDC()));
+		}
+
+		const int numCoefs() const noexcept { return static_cast<int>(coefs0.size() + coefs1.size()); }
+
+		/* group delay at dc in samples of the higher rate */
+		double getGroupDelayDC() const noexcept
+		{
+			// a first order allpass (c + z^-1) / (1 + c z^-1) delays dc by (1 - c) / (1 + c)
+			// samples of the lower rate. the odd branch is one sample of the higher rate late.
+			const auto groupDelay = [](const std::vector<Float>& coefs)
+			{
+				auto d = 0.;
+				for (const auto c : coefs)
+					d += (1. - static_cast<double>(c)) / (1. + static_cast<double>(c));
+				return d;
+			};
+			return groupDelay(coefs0) + groupDelay(coefs1) + .5;
+		}
+
+		/* coefficients of the even (0) and the odd (1) branch */
+		std::vector<Float> coefs0, coefs1;
+		/* rounded group delay at dc in samples of the higher rate */
+		int latency;
+
+	protected:
+		/* returns { k, q } */
+		static std::array<double, 2> getTransitionParams(double transition) noexcept
+		{
+			auto k = std::tan((1. - transition * 2.) * pi * .25);
+			k *= k;
+			const auto kksqrt = std::pow(1. - k * k, .25);
+			const auto e = .5 * (1. - kksqrt) / (1. + kksqrt);
+			const auto e2 = e * e;
+			const auto e4 = e2 * e2;
+			const auto q = e * (1. + e4 * (2. + e4 * (15. + 150. * e4)));
+			return { k, q };
+		}
+
+		static int getNumCoefs(double attenuationDb, double q) noexcept
+		{
+			const auto attnP2 = std::pow(10., -attenuationDb * .1);
+			const auto a = attnP2 / (1. - attnP2);
+			auto order = static_cast<int>(std::ceil(std::log(a * a / 16.) / std::log(q)));
+			if (order % 2 == 0)
+				++order;
+			if (order < 3)
+				order = 3;
+			return (order - 1) / 2;
+		}
+
+		static double getCoef(int index, double k, double q, int order) noexcept
+		{
+			const auto c = static_cast<double>(index + 1);
+			const auto orderD = static_cast<double>(order);
+
+			auto num = 0.;
+			{
+				auto sign = 1.;
+				for (auto i = 0; i < 64; ++i)
+				{
+					const auto iD = static_cast<double>(i);
+					const auto term = std::pow(q, iD * (iD + 1.)) * std::sin((iD * 2. + 1.) * c * pi / orderD) * sign;
+					num += term;
+					sign = -sign;
+					if (std::abs(term) < 1e-100)
+						break;
+				}
+				num *= std::pow(q, .25);
+			}
+
+			auto den = .5;
+			{
+				auto sign = -1.;
+				for (auto i = 1; i < 64; ++i)
+				{
+					const auto iD = static_cast<double>(i);
+					const auto term = std::pow(q, iD * iD) * std::cos(iD * 2. * c * pi / orderD) * sign;
+					den += term;
+					sign = -sign;
+					if (std::abs(term) < 1e-100)
+						break;
+				}
+			}
+
+			const auto ww = num / den;
+			const auto wwsq = ww * ww;
+			const auto x = std::sqrt((1. - wwsq * k) * (1. - wwsq / k)) / (1. + wwsq);
+			return (1. - x) / (1. + x);
+		}
+	};
+
+	/* a chain of first order allpasses (c + z^-1) / (1 + c z^-1) */
+	template<typename Float, int MaxNumCoefs>
+	struct AllpassChain
+	{
+		AllpassChain() :
+			x(),
+			y()
+		{
+			reset();
+		}
+
+		void reset() noexcept
+		{
+			x.fill(static_cast<Float>(0));
+			y.fill(static_cast<Float>(0));
+		}
+
+		Float operator()(Float smpl, const Float* coefs, int numCoefs) noexcept
+		{
+			for (auto i = 0; i < numCoefs; ++i)
+			{
+				const auto out = (smpl - y[i]) * coefs[i] + x[i];
+				x[i] = smpl;
+				y[i] = out;
+				smpl = out;
+			}
+			return smpl;
+		}
+
+	protected:
+		std::array<Float, MaxNumCoefs> x, y;
+	};
+
+	/*
+	* one 2x stage of the allpass polyphase resampler.
+	* same interface as HalfbandFilter, so Processor can treat both alike.
+	*/
+	template<typename Float>
+	struct AllpassHalfbandFilter
+	{
+		static constexpr int MaxNumChannels = 4;
+		static constexpr int MaxNumCoefsPerBranch = 12;
+		using Chain = AllpassChain<Float, MaxNumCoefsPerBranch>;
+
+		AllpassHalfbandFilter() :
+			kernel(),
+			ups(),
+			downs(),
+			oddPrev(),
+			scratch()
+		{
+		}
+
+		/* kernel, maxNumSamples at the lower rate */
+		void prepare(const AllpassHalfbandKernel<Float>& _kernel, int maxNumSamples)
+		{
+			kernel = _kernel;
+			scratch.assign(maxNumSamples, static_cast<Float>(0));
+			for (auto& branches : ups)
+				for (auto& chain : branches)
+					chain.reset();
+			for (auto& branches : downs)
+				for (auto& chain : branches)
+					chain.reset();
+			oddPrev.fill(static_cast<Float>(0));
+		}
+
+		/* rounded group delay at dc of up- and downsampling in samples of the higher rate */
+		int getLatency() const noexcept
+		{
+			return kernel.latency * 2;
+		}
+
+		/* group delay at dc of up- and downsampling in samples of the higher rate */
+		double getGroupDelay() const noexcept
+		{
+			return kernel.getGroupDelayDC() * 2.;
+		}
+
+		/* dest, src, numChannels, numSamples (lower rate). dest may be src */
+		void processBlockUp(Float* const* dest, const Float* const* src, int numChannels, int numSamples) noexcept
+		{
+			const auto c0 = kernel.coefs0.data();
+			const auto c1 = kernel.coefs1.data();
+			const auto n0 = static_cast<int>(kernel.coefs0.size());
+			const auto n1 = static_cast<int>(kernel.coefs1.size());
+
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto& branches = ups[ch];
+				auto d = dest[ch];
+				auto x = scratch.data();
+				for (auto i = 0; i < numSamples; ++i)
+					x[i] = src[ch][i];
+				for (auto i = 0; i < numSamples; ++i)
+				{
+					const auto i2 = i * 2;
+					d[i2] = branches[0](x[i], c0, n0);
+					d[i2 + 1] = branches[1](x[i], c1, n1);
+				}
+			}
+		}
+
+		/* dest, src, numChannels, numSamples (lower rate). dest may be src */
+		void processBlockDown(Float* const* dest, const Float* const* src, int numChannels, int numSamples) noexcept
+		{
+			const auto c0 = kernel.coefs0.data();
+			const auto c1 = kernel.coefs1.data();
+			const auto n0 = static_cast<int>(kernel.coefs0.size());
+			const auto n1 = static_cast<int>(kernel.coefs1.size());
+
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto& branches = downs[ch];
+				auto d = dest[ch];
+				const auto s = src[ch];
+				auto& prev = oddPrev[ch];
+				for (auto i = 0; i < numSamples; ++i)
+				{
+					const auto i2 = i * 2;
+					const auto even = s[i2];
+					const auto odd = s[i2 + 1];
+					d[i] = static_cast<Float>(.5) * (branches[0](even, c0, n0) + branches[1](prev, c1, n1));
+					prev = odd;
+				}
+			}
+		}
+
+	protected:
+		AllpassHalfbandKernel<Float> kernel;
+		std::array<std::array<Chain, 2>, MaxNumChannels> ups, downs;
+		std::array<Float, MaxNumChannels> oddPrev;
+		std::vector<Float> scratch;
+	};
+}
\ No newline at end of file
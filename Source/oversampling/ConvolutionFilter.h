@@ -1,5 +1,11 @@
 #pragma once
 #include "Filter.h"
+#include "../SIMD.h"
+#include <vector>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <algorithm>
 
 namespace oversampling
 {
@@ -10,22 +16,66 @@ namespace oversampling
 	{
 		ImpulseResponse() :
 			data(),
+			kernel(),
+			kernelEven(),
+			kernelOdd(),
 			latency(0)
 		{
 			data.resize(1, static_cast<Float>(1));
+			makeKernels();
 		}
 		
 		ImpulseResponse(const std::vector<Float>& _data) :
 			data(_data),
+			kernel(),
+			kernelEven(),
+			kernelOdd(),
 			latency(static_cast<int>(data.size()) / 2)
 		{
+			makeKernels();
+		}
+
+		/* data, latency (for kernels that aren't linear phase) */
+		ImpulseResponse(const std::vector<Float>& _data, int _latency) :
+			data(_data),
+			kernel(),
+			kernelEven(),
+			kernelOdd(),
+			latency(_latency)
+		{
+			makeKernels();
 		}
 		
 		Float operator[](int i) const noexcept { return data[i]; }
 		const size_t size() const noexcept { return data.size(); }
+		/* number of taps of each polyphase branch of a 2x upsampler */
+		const int numPolyphaseTaps() const noexcept { return static_cast<int>(kernelEven.size()); }
 
 		std::vector<Float> data;
+		/*
+		* data reversed (oldest sample first), so it lines up with a linear history.
+		* kernelEven / kernelOdd are the reversed polyphase branches of a zero-stuffing upsampler,
+		* both padded to the same length so they share one history.
+		*/
+		std::vector<Float> kernel, kernelEven, kernelOdd;
 		int latency;
+
+	protected:
+		void makeKernels()
+		{
+			const auto N = static_cast<int>(data.size());
+			kernel.assign(data.rbegin(), data.rend());
+
+			const auto numTaps = (N + 1) / 2;
+			kernelEven.resize(numTaps);
+			kernelOdd.resize(numTaps);
+			for (auto j = 0; j < numTaps; ++j)
+			{
+				const auto i = 2 * (numTaps - 1 - j);
+				kernelEven[j] = data[i];
+				kernelOdd[j] = i + 1 < N ? data[i + 1] : static_cast<Float>(0);
+			}
+		}
 	};
 
 	/*
@@ -81,106 +131,217 @@ namespace oversampling
 		return ir;
 	}
 
+	/* in-place radix-2 fft, x.size() must be a power of 2. inverse isn't normalised */
+	inline void fft(std::vector<std::complex<double>>& x, bool inverse)
+	{
+		const auto N = static_cast<int>(x.size());
+		for (auto i = 1, j = 0; i < N; ++i)
+		{
+			auto bit = N >> 1;
+			for (; (j & bit) != 0; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if (i < j)
+				std::swap(x[i], x[j]);
+		}
+		for (auto len = 2; len <= N; len <<= 1)
+		{
+			const auto angle = (inverse ? tau : -tau) / static_cast<double>(len);
+			const std::complex<double> wLen(std::cos(angle), std::sin(angle));
+			for (auto i = 0; i < N; i += len)
+			{
+				std::complex<double> w(1.);
+				const auto lenHalf = len / 2;
+				for (auto j = 0; j < lenHalf; ++j)
+				{
+					const auto u = x[i + j];
+					const auto v = x[i + j + lenHalf] * w;
+					x[i + j] = u + v;
+					x[i + j + lenHalf] = u - v;
+					w *= wLen;
+				}
+			}
+		}
+	}
+
+	/*
+	* homomorphic (real cepstrum) conversion to the minimum phase filter with the same magnitude response.
+	* the energy moves to the start of the kernel, so the latency drops from size / 2
+	* to the group delay at dc, at the cost of phase distortion near the cutoff.
+	*/
+	template<typename Float>
+	inline ImpulseResponse<Float> makeMinimumPhase(const ImpulseResponse<Float>& ir)
+	{
+		const auto N = static_cast<int>(ir.size());
+		// a long fft keeps the cepstrum from aliasing
+		auto L = 1024;
+		while (L < N * 32)
+			L <<= 1;
+		const auto LInv = 1. / static_cast<double>(L);
+
+		std::vector<std::complex<double>> x(L, 0.);
+		for (auto n = 0; n < N; ++n)
+			x[n] = static_cast<double>(ir[n]);
+		fft(x, false);
+
+		// log magnitude, floored at -200db where the blackman window has its stopband nulls
+		for (auto& X : x)
+			X = std::log(std::max(std::abs(X), 1e-10));
+		fft(x, true);
+
+		// fold the real cepstrum onto its causal half
+		const auto LHalf = L / 2;
+		x[0] *= LInv;
+		for (auto n = 1; n < LHalf; ++n)
+			x[n] *= 2. * LInv;
+		x[LHalf] *= LInv;
+		for (auto n = LHalf + 1; n < L; ++n)
+			x[n] = 0.;
+
+		fft(x, false);
+		for (auto& X : x)
+			X = std::exp(X);
+		fft(x, true);
+
+		std::vector<Float> data(N);
+		auto sum = 0.;
+		auto moment = 0.;
+		for (auto n = 0; n < N; ++n)
+		{
+			const auto y = x[n].real() * LInv;
+			data[n] = static_cast<Float>(y);
+			sum += y;
+			moment += y * static_cast<double>(n);
+		}
+		const auto latency = sum != 0. ? static_cast<int>(std::round(moment / sum)) : 0;
+		return ImpulseResponse<Float>(data, latency);
+	}
+
 	template<typename Float>
 	struct Convolution
 	{
 		using IR = ImpulseResponse<Float>;
 
-		Convolution(const IR& ir) :
-			buffer(),
+		/* ir, upsampling (history of the polyphase branches instead of the full ir) */
+		Convolution(const IR& ir, bool upsampling = false) :
+			history(),
+			size(upsampling ? ir.numPolyphaseTaps() : static_cast<int>(ir.size())),
 			wIdx(0)
 		{
-			buffer.resize(ir.size(), static_cast<Float>(0));
+			history.resize(size * 2, static_cast<Float>(0));
 		}
 
 		void processBlock(Float* audioBuffer, const IR& ir, const int numSamples) noexcept
 		{
+			const auto kernel = ir.kernel.data();
 			for (auto s = 0; s < numSamples; ++s)
 			{
-				++wIdx;
-				if (wIdx == ir.size())
-					wIdx = 0;
-				buffer[wIdx] = audioBuffer[s];
-
-				auto y = 0.;
-				auto rIdx = wIdx;
-				for (auto i = 0; i < ir.size(); ++i)
-				{
-					y += buffer[rIdx] * ir[i];
-					--rIdx;
-					if (rIdx == -1)
-						rIdx = static_cast<int>(ir.size()) - 1;
-				}
-				audioBuffer[s] = y;
+				write(audioBuffer[s]);
+				audioBuffer[s] = vec::dot(kernel, window(), size);
+			}
+		}
+
+		/* processes the left and right channel in one pass, sharing every kernel load */
+		static void processBlock(Convolution& l, Convolution& r, Float* audioBufferL, Float* audioBufferR,
+			const IR& ir, const int numSamples) noexcept
+		{
+			const auto kernel = ir.kernel.data();
+			const auto size = l.size;
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				l.write(audioBufferL[s]);
+				r.write(audioBufferR[s]);
+				vec::dot2(kernel, l.window(), r.window(), size, audioBufferL[s], audioBufferR[s]);
 			}
 		}
 		
 		void processBlockUp(Float* audioBuffer, const IR& ir, const int numSamples) noexcept
 		{
+			const auto kernelEven = ir.kernelEven.data();
+			const auto kernelOdd = ir.kernelOdd.data();
 			for (auto s = 0; s < numSamples; s += 2)
 			{
-				audioBuffer[s] = processSampleUpEven(audioBuffer[s], ir);
-				audioBuffer[s + 1] = processSampleUpOdd(ir);
+				write(audioBuffer[s]);
+				const auto x = window();
+				audioBuffer[s] = vec::dot(kernelEven, x, size);
+				audioBuffer[s + 1] = vec::dot(kernelOdd, x, size);
 			}
 		}
-		
-		Float processSampleUpEven(const Float sample, const IR& ir) noexcept
+
+		/* processes the left and right channel in one pass, sharing every kernel load */
+		static void processBlockUp(Convolution& l, Convolution& r, Float* audioBufferL, Float* audioBufferR,
+			const IR& ir, const int numSamples) noexcept
 		{
-			const auto irSize = static_cast<int>(ir.size());
-			buffer[wIdx] = sample;
-			auto y = 0.;
-			auto rIdx = wIdx;
-			for (auto i = 0; i < irSize; i += 2)
+			const auto kernelEven = ir.kernelEven.data();
+			const auto kernelOdd = ir.kernelOdd.data();
+			const auto size = l.size;
+			for (auto s = 0; s < numSamples; s += 2)
 			{
-				y += buffer[rIdx] * ir[i];
-				rIdx -= 2;
-				if (rIdx < 0)
-					rIdx += irSize;
+				l.write(audioBufferL[s]);
+				r.write(audioBufferR[s]);
+				const auto xL = l.window();
+				const auto xR = r.window();
+				vec::dot2(kernelEven, xL, xR, size, audioBufferL[s], audioBufferR[s]);
+				vec::dot2(kernelOdd, xL, xR, size, audioBufferL[s + 1], audioBufferR[s + 1]);
 			}
-			++wIdx;
-			if (wIdx == irSize)
-				wIdx = 0;
-			return y;
+		}
+		
+		Float processSampleUpEven(const Float sample, const IR& ir) noexcept
+		{
+			write(sample);
+			return vec::dot(ir.kernelEven.data(), window(), size);
 		}
 		
 		Float processSampleUpOdd(const IR& ir) noexcept
 		{
-			const auto irSize = static_cast<int>(ir.size());
-			auto y = 0.;
-			auto rIdx = wIdx - 1;
-			if (rIdx == -1)
-				rIdx = irSize - 1;
-			buffer[wIdx] = 0.f;
-			for (auto i = 1; i < irSize; i += 2)
-			{
-				y += buffer[rIdx] * ir[i];
-				rIdx -= 2;
-				if (rIdx < 0)
-					rIdx += irSize;
-			}
-			++wIdx;
-			if (wIdx == irSize)
-				wIdx = 0;
-			return y;
+			// the stuffed zero doesn't need to be written, the odd branch reads the same history
+			return vec::dot(ir.kernelOdd.data(), window(), size);
 		}
 		
 	protected:
-		std::vector<Float> buffer;
-		int wIdx;
+		/*
+		* every sample is written twice (wIdx and wIdx + size),
+		* so the last size samples are always contiguous from oldest to newest
+		* and each output is a single dot product without wrapping.
+		*/
+		std::vector<Float> history;
+		int size, wIdx;
+
+		void write(const Float sample) noexcept
+		{
+			history[wIdx] = sample;
+			history[wIdx + size] = sample;
+			++wIdx;
+			if (wIdx == size)
+				wIdx = 0;
+		}
+
+		const Float* window() const noexcept
+		{
+			return history.data() + wIdx;
+		}
 	};
 
 	template<typename Float>
 	struct ConvolutionFilter
 	{
-		using Convolution = Convolution<Float>;
-		using IR = Convolution::IR;
+		using Conv = Convolution<Float>;
+		using IR = typename Conv::IR;
 		
 		ConvolutionFilter(Float _Fs = static_cast<Float>(1),
 			Float _cutoff = static_cast<Float>(.25), Float _bandwidth = static_cast<Float>(.25),
 				bool upsampling = false) :
 			ir(makeSincFilter2(_Fs, _cutoff, _bandwidth, upsampling)),
-			filters{ ir, ir, ir, ir }
+			filters{ Conv(ir, upsampling), Conv(ir, upsampling), Conv(ir, upsampling), Conv(ir, upsampling) }
+		{
+		}
+		
+		/* ir, upsampling */
+		void prepare(const IR& _ir, bool upsampling)
 		{
+			ir = _ir;
+			for (auto& filter : filters)
+				filter = Conv(ir, upsampling);
 		}
 		
 		int getLatency() const noexcept
@@ -190,13 +351,19 @@ namespace oversampling
 		
 		void processBlockDown(Float* const* audioBuffer, int numChannels, int numSamples) noexcept
 		{
-			for (auto ch = 0; ch < numChannels; ++ch)
+			auto ch = 0;
+			for (; ch + 1 < numChannels; ch += 2)
+				Conv::processBlock(filters[ch], filters[ch + 1], audioBuffer[ch], audioBuffer[ch + 1], ir, numSamples);
+			for (; ch < numChannels; ++ch)
 				filters[ch].processBlock(audioBuffer[ch], ir, numSamples);
 		}
 		
 		void processBlockUp(Float* const* audioBuffer, int numChannels, int numSamples) noexcept
 		{
-			for (auto ch = 0; ch < numChannels; ++ch)
+			auto ch = 0;
+			for (; ch + 1 < numChannels; ch += 2)
+				Conv::processBlockUp(filters[ch], filters[ch + 1], audioBuffer[ch], audioBuffer[ch + 1], ir, numSamples);
+			for (; ch < numChannels; ++ch)
 				filters[ch].processBlockUp(audioBuffer[ch], ir, numSamples);
 		}
 		
@@ -212,6 +379,6 @@ namespace oversampling
 		
 	protected:
 		IR ir;
-		std::array<Convolution, 4> filters;
+		std::array<Conv, 4> filters;
 	};
 }
\ No newline at end of file
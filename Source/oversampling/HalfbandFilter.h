@@ -0,0 +1,368 @@
+#pragma once
+#include "Filter.h"
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace oversampling
+{
+	/*
+	* halfband lowpass (fc = Fs / 4) windowed by a kaiser window.
+	* numTaps = 4k - 1, so the outermost taps are non-zero.
+	* every even distance from the centre tap is exactly zero and the centre tap is .5,
+	* which means one polyphase branch of a 2x resampler is a pure delay
+	* and the other one only holds (numTaps + 1) / 2 taps.
+	*/
+
+	template<typename Float>
+	inline Float besselI0(Float x) noexcept
+	{
+		const auto xHalf = x * static_cast<Float>(.5);
+		auto sum = static_cast<Float>(1);
+		auto term = static_cast<Float>(1);
+		for (auto k = 1; k < 64; ++k)
+		{
+			const auto a = xHalf / static_cast<Float>(k);
+			term *= a * a;
+			sum += term;
+			if (term < sum * static_cast<Float>(1e-12))
+				break;
+		}
+		return sum;
+	}
+
+	/* attenuationDb. kaiser's window parameter for a stopband attenuation */
+	inline double getKaiserBeta(double attenuationDb) noexcept
+	{
+		if (attenuationDb > 50.)
+			return .1102 * (attenuationDb - 8.7);
+		if (attenuationDb > 21.)
+			return .5842 * std::pow(attenuationDb - 21., .4) + .07886 * (attenuationDb - 21.);
+		return 0.;
+	}
+
+	/* attenuationDb, transition (normalised to the higher rate). kaiser's length estimate, rounded up to 4k - 1 */
+	inline int getKaiserHalfbandNumTaps(double attenuationDb, double transition) noexcept
+	{
+		const auto numTaps = (attenuationDb - 7.95) / (14.36 * transition) + 1.;
+		const auto k = std::max(1, static_cast<int>(std::ceil((numTaps + 1.) * .25)));
+		return 4 * k - 1;
+	}
+
+	template<typename Float>
+	struct HalfbandKernel
+	{
+		/* numTaps (4k - 1), beta (kaiser) */
+		HalfbandKernel(int _numTaps = 3, Float beta = static_cast<Float>(7)) :
+			branch(),
+			numTaps(_numTaps),
+			latency((_numTaps - 1) / 2)
+		{
+			const auto centre = (numTaps - 1) / 2;
+			const auto centreF = static_cast<Float>(centre);
+			const auto i0Beta = besselI0(beta);
+
+			const auto numBranchTaps = (numTaps + 1) / 2;
+			branch.reserve(numBranchTaps);
+			auto sum = static_cast<Float>(0);
+			for (auto i = 0; i < numBranchTaps; ++i)
+			{
+				const auto n = static_cast<Float>(2 * i);
+				const auto x = n - centreF; // always odd
+				const auto xPi = static_cast<Float>(pi) * x * static_cast<Float>(.5);
+				const auto sinc = std::sin(xPi) / xPi * static_cast<Float>(.5);
+				const auto r = x / centreF;
+				const auto w = besselI0(beta * std::sqrt(static_cast<Float>(1) - r * r)) / i0Beta;
+				branch.emplace_back(sinc * w);
+				sum += branch.back();
+			}
+			// the centre tap contributes the other half of the dc gain
+			const auto norm = static_cast<Float>(.5) / sum;
+			for (auto& b : branch)
+				b *= norm;
+		}
+
+		const int numBranchTaps() const noexcept { return static_cast<int>(branch.size()); }
+
+		/* transition (normalised to the higher rate). the weakest attenuation between the stopband edge and nyquist */
+		double getStopbandAttenuationDb(double transition) const noexcept
+		{
+			static constexpr int NumChecks = 256;
+			const auto centre = static_cast<double>((numTaps - 1) / 2);
+			const auto fStop = .25 + transition * .5;
+			auto maxMag = 0.;
+			for (auto i = 0; i <= NumChecks; ++i)
+			{
+				const auto f = fStop + (.5 - fStop) * static_cast<double>(i) / static_cast<double>(NumChecks);
+				// the centre tap and the even branch, relative to the centre
+				auto re = .5;
+				auto im = 0.;
+				for (auto j = 0; j < numBranchTaps(); ++j)
+				{
+					const auto w = tau * f * (static_cast<double>(2 * j) - centre);
+					re += static_cast<double>(branch[j]) * std::cos(w);
+					im -= static_cast<double>(branch[j]) * std::sin(w);
+				}
+				maxMag = std::max(maxMag, std::sqrt(re * re + im * im));
+			}
+			return -20. * std::log10(std::max(maxMag, 1e-15));
+		}
+
+		/* the non-zero taps of the even polyphase branch */
+		std::vector<Float> branch;
+		/* numTaps of the full filter, latency in samples of the higher rate */
+		int numTaps, latency;
+	};
+
+	/*
+	* attenuationDb, transition (normalised to the higher rate), maxNumTaps.
+	* kaiser's formulas are estimates that fall a few db short on short kernels,
+	* so the window aims a bit higher and the kernel grows until the stopband holds
+	*/
+	template<typename Float>
+	inline HalfbandKernel<Float> makeHalfbandKernel(double attenuationDb, double transition, int maxNumTaps = 255)
+	{
+		const auto beta = static_cast<Float>(getKaiserBeta(attenuationDb + 1.));
+		auto numTaps = std::min(getKaiserHalfbandNumTaps(attenuationDb, transition), maxNumTaps);
+		HalfbandKernel<Float> kernel(numTaps, beta);
+		while (kernel.getStopbandAttenuationDb(transition) < attenuationDb && numTaps + 4 <= maxNumTaps)
+		{
+			numTaps += 4;
+			kernel = HalfbandKernel<Float>(numTaps, beta);
+		}
+		return kernel;
+	}
+
+	template<typename Float>
+	struct HalfbandUp
+	{
+		HalfbandUp() :
+			history(),
+			numBranchTaps(0),
+			delay(0)
+		{}
+
+		/* kernel, maxNumSamplesIn */
+		void prepare(const HalfbandKernel<Float>& kernel, int maxNumSamples)
+		{
+			numBranchTaps = kernel.numBranchTaps();
+			delay = numBranchTaps / 2 - 1;
+			history.assign(numBranchTaps - 1 + maxNumSamples, static_cast<Float>(0));
+		}
+
+		/* dest (2 * numSamples), src (numSamples), numSamples. dest may be src */
+		void operator()(Float* dest, const Float* src, const HalfbandKernel<Float>& kernel, int numSamples) noexcept
+		{
+			const auto offset = numBranchTaps - 1;
+			auto hist = history.data();
+			for (auto s = 0; s < numSamples; ++s)
+				hist[offset + s] = src[s];
+
+			const auto g = kernel.branch.data();
+			const auto numFolds = numBranchTaps / 2;
+
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				const auto x = &hist[s];
+				auto y = static_cast<Float>(0);
+				// symmetric kernel: fold the history instead of multiplying each tap
+				for (auto i = 0; i < numFolds; ++i)
+					y += g[i] * (x[offset - i] + x[i]);
+				const auto s2 = s * 2;
+				dest[s2] = y * static_cast<Float>(2);
+				dest[s2 + 1] = x[offset - delay];
+			}
+
+			for (auto i = 0; i < offset; ++i)
+				hist[i] = hist[numSamples + i];
+		}
+
+	protected:
+		std::vector<Float> history;
+		int numBranchTaps, delay;
+	};
+
+	template<typename Float>
+	struct HalfbandDown
+	{
+		HalfbandDown() :
+			historyEven(),
+			historyOdd(),
+			numBranchTaps(0),
+			delay(0)
+		{}
+
+		/* kernel, maxNumSamplesOut */
+		void prepare(const HalfbandKernel<Float>& kernel, int maxNumSamples)
+		{
+			numBranchTaps = kernel.numBranchTaps();
+			delay = numBranchTaps / 2;
+			historyEven.assign(numBranchTaps - 1 + maxNumSamples, static_cast<Float>(0));
+			historyOdd.assign(delay + maxNumSamples, static_cast<Float>(0));
+		}
+
+		/* dest (numSamples), src (2 * numSamples), numSamples. dest may be src */
+		void operator()(Float* dest, const Float* src, const HalfbandKernel<Float>& kernel, int numSamples) noexcept
+		{
+			const auto offset = numBranchTaps - 1;
+			auto even = historyEven.data();
+			auto odd = historyOdd.data();
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				const auto s2 = s * 2;
+				even[offset + s] = src[s2];
+				odd[delay + s] = src[s2 + 1];
+			}
+
+			const auto g = kernel.branch.data();
+			const auto numFolds = numBranchTaps / 2;
+
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				const auto x = &even[s];
+				auto y = static_cast<Float>(0);
+				for (auto i = 0; i < numFolds; ++i)
+					y += g[i] * (x[offset - i] + x[i]);
+				dest[s] = y + static_cast<Float>(.5) * odd[s];
+			}
+
+			for (auto i = 0; i < offset; ++i)
+				even[i] = even[numSamples + i];
+			for (auto i = 0; i < delay; ++i)
+				odd[i] = odd[numSamples + i];
+		}
+
+	protected:
+		std::vector<Float> historyEven, historyOdd;
+		int numBranchTaps, delay;
+	};
+
+	/*
+	* one 2x stage of a polyphase halfband resampler.
+	* the upsampler never multiplies the stuffed zeros
+	* and the downsampler never computes the discarded outputs.
+	*/
+	template<typename Float>
+	struct HalfbandFilter
+	{
+		static constexpr int MaxNumChannels = 4;
+
+		/* numTaps (4k - 1), beta (kaiser) */
+		HalfbandFilter(int numTaps = 3, Float beta = static_cast<Float>(7)) :
+			kernel(numTaps, beta),
+			ups(),
+			downs()
+		{
+		}
+
+		/* kernel, maxNumSamples at the lower rate */
+		void prepare(const HalfbandKernel<Float>& _kernel, int maxNumSamples)
+		{
+			kernel = _kernel;
+			prepare(maxNumSamples);
+		}
+
+		/* maxNumSamples at the lower rate */
+		void prepare(int maxNumSamples)
+		{
+			for (auto& up : ups)
+				up.prepare(kernel, maxNumSamples);
+			for (auto& down : downs)
+				down.prepare(kernel, maxNumSamples);
+		}
+
+		/* latency of up- and downsampling in samples of the higher rate */
+		int getLatency() const noexcept
+		{
+			return kernel.latency * 2;
+		}
+
+		/* dest, src, numChannels, numSamples (lower rate) */
+		void processBlockUp(Float* const* dest, const Float* const* src, int numChannels, int numSamples) noexcept
+		{
+			for (auto ch = 0; ch < numChannels; ++ch)
+				ups[ch](dest[ch], src[ch], kernel, numSamples);
+		}
+
+		/* dest, src, numChannels, numSamples (lower rate) */
+		void processBlockDown(Float* const* dest, const Float* const* src, int numChannels, int numSamples) noexcept
+		{
+			for (auto ch = 0; ch < numChannels; ++ch)
+				downs[ch](dest[ch], src[ch], kernel, numSamples);
+		}
+
+	protected:
+		HalfbandKernel<Float> kernel;
+		std::array<HalfbandUp<Float>, MaxNumChannels> ups;
+		std::array<HalfbandDown<Float>, MaxNumChannels> downs;
+	};
+
+	/* integer delay that pads the latency of a resampler to whole samples of the base rate */
+	template<typename Float, int MaxDelay>
+	struct PadDelay
+	{
+		static constexpr int MaxNumChannels = 4;
+
+		PadDelay() :
+			history(),
+			scratch(),
+			delay(0)
+		{
+			for (auto& h : history)
+				h.fill(static_cast<Float>(0));
+		}
+
+		void setDelay(int d) noexcept
+		{
+			delay = d;
+			for (auto& h : history)
+				h.fill(static_cast<Float>(0));
+		}
+
+		void operator()(Float* const* samples, int numChannels, int numSamples) noexcept
+		{
+			if (delay == 0)
+				return;
+
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto smpls = samples[ch];
+				auto& hist = history[ch];
+
+				if (numSamples < delay)
+				{
+					for (auto i = 0; i < delay; ++i)
+						scratch[i] = hist[i];
+					for (auto s = 0; s < numSamples; ++s)
+						scratch[delay + s] = smpls[s];
+					for (auto s = 0; s < numSamples; ++s)
+						smpls[s] = scratch[s];
+					for (auto i = 0; i < delay; ++i)
+						hist[i] = scratch[numSamples + i];
+					continue;
+				}
+
+				for (auto i = 0; i < delay; ++i)
+					scratch[i] = smpls[numSamples - delay + i];
+				for (auto s = numSamples - 1; s >= delay; --s)
+					smpls[s] = smpls[s - delay];
+				for (auto i = 0; i < delay; ++i)
+				{
+					smpls[i] = hist[i];
+					hist[i] = scratch[i];
+				}
+			}
+		}
+
+		int getLatency() const noexcept
+		{
+			return delay;
+		}
+
+	protected:
+		std::array<std::array<Float, MaxDelay>, MaxNumChannels> history;
+		std::array<Float, MaxDelay * 2> scratch;
+		int delay;
+	};
+}
\ No newline at end of file
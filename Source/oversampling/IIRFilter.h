@@ -1,6 +1,8 @@
 #pragma once
 #include "Filter.h"
+#include "../SIMD.h"
 #include <array>
+#include <type_traits>
 
 namespace oversampling
 {
@@ -224,14 +226,182 @@ namespace oversampling
 		Float t, tt, w, wHalf, m, d, dInv, x0, x1, x2, y1, y2, k, kk, a0, a1, a2, b1, b2;
 	};
 
+	/* normalised biquad coefficients (a0 = 1) */
+	template<typename Float>
+	struct BiquadCoefs
+	{
+		Float b0, b1, b2, a1, a2;
+	};
+
+#if NEL_SIMD_SSE2
+	namespace sos
+	{
+		/*
+		* coefs, z1, z2, l, r, numSamples
+		* z1[i] and z2[i] point to the states of both channels of section i.
+		* the states stay in registers for the whole block.
+		*/
+		template<int NumSections>
+		inline void processStereo(const std::array<BiquadCoefs<double>, NumSections>& coefs,
+			const std::array<double*, NumSections>& z1, const std::array<double*, NumSections>& z2,
+			double* l, double* r, int numSamples) noexcept
+		{
+			std::array<__m128d, NumSections> b0, b1, b2, a1, a2, s1, s2;
+			for (auto i = 0; i < NumSections; ++i)
+			{
+				b0[i] = _mm_set1_pd(coefs[i].b0);
+				b1[i] = _mm_set1_pd(coefs[i].b1);
+				b2[i] = _mm_set1_pd(coefs[i].b2);
+				a1[i] = _mm_set1_pd(coefs[i].a1);
+				a2[i] = _mm_set1_pd(coefs[i].a2);
+				s1[i] = _mm_loadu_pd(z1[i]);
+				s2[i] = _mm_loadu_pd(z2[i]);
+			}
+
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				auto x = _mm_set_pd(r[s], l[s]);
+				for (auto i = 0; i < NumSections; ++i)
+				{
+					const auto y = _mm_add_pd(_mm_mul_pd(b0[i], x), s1[i]);
+					s1[i] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1[i], x), _mm_mul_pd(a1[i], y)), s2[i]);
+					s2[i] = _mm_sub_pd(_mm_mul_pd(b2[i], x), _mm_mul_pd(a2[i], y));
+					x = y;
+				}
+				_mm_storel_pd(&l[s], x);
+				_mm_storeh_pd(&r[s], x);
+			}
+
+			for (auto i = 0; i < NumSections; ++i)
+			{
+				_mm_storeu_pd(z1[i], s1[i]);
+				_mm_storeu_pd(z2[i], s2[i]);
+			}
+		}
+	}
+#endif
+
+	/*
+	* cascade of second order sections in transposed direct form 2.
+	* channel pairs (l/r) run through the cascade together,
+	* so with sse2 one register holds the state of both channels.
+	*/
+	template<typename Float, int NumSections>
+	struct BiquadCascade
+	{
+		static constexpr int MaxNumChannels = 4;
+		using Coefs = BiquadCoefs<Float>;
+		using Sections = std::array<Coefs, NumSections>;
+
+		BiquadCascade() :
+			coefs(),
+			z1(),
+			z2()
+		{
+			for (auto& c : coefs)
+				c = { static_cast<Float>(1), static_cast<Float>(0), static_cast<Float>(0), static_cast<Float>(0), static_cast<Float>(0) };
+			reset();
+		}
+
+		void setCoefs(const Sections& _coefs) noexcept
+		{
+			coefs = _coefs;
+		}
+
+		void reset() noexcept
+		{
+			for (auto& z : z1)
+				z.fill(static_cast<Float>(0));
+			for (auto& z : z2)
+				z.fill(static_cast<Float>(0));
+		}
+
+		void processBlock(Float* const* samples, int numChannels, const int numSamples) noexcept
+		{
+			auto ch = 0;
+			for (; ch + 1 < numChannels; ch += 2)
+				processBlockStereo(samples[ch], samples[ch + 1], ch, numSamples);
+			for (; ch < numChannels; ++ch)
+				processBlockMono(samples[ch], ch, numSamples);
+		}
+
+		Float processSample(Float x, int ch) noexcept
+		{
+			for (auto i = 0; i < NumSections; ++i)
+			{
+				const auto& c = coefs[i];
+				const auto y = c.b0 * x + z1[i][ch];
+				z1[i][ch] = c.b1 * x - c.a1 * y + z2[i][ch];
+				z2[i][ch] = c.b2 * x - c.a2 * y;
+				x = y;
+			}
+			return x;
+		}
+
+	protected:
+		Sections coefs;
+		/* state of each section, the channels of a pair are adjacent */
+		std::array<std::array<Float, MaxNumChannels>, NumSections> z1, z2;
+
+		void processBlockMono(Float* smpls, int ch, int numSamples) noexcept
+		{
+			for (auto s = 0; s < numSamples; ++s)
+				smpls[s] = processSample(smpls[s], ch);
+		}
+
+		void processBlockStereo(Float* l, Float* r, int ch, int numSamples) noexcept
+		{
+#if NEL_SIMD_SSE2
+			if constexpr (std::is_same<Float, double>::value)
+			{
+				std::array<double*, NumSections> z1p, z2p;
+				for (auto i = 0; i < NumSections; ++i)
+				{
+					z1p[i] = &z1[i][ch];
+					z2p[i] = &z2[i][ch];
+				}
+				sos::processStereo<NumSections>(coefs, z1p, z2p, l, r, numSamples);
+				return;
+			}
+#endif
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				auto xL = l[s];
+				auto xR = r[s];
+				for (auto i = 0; i < NumSections; ++i)
+				{
+					const auto& c = coefs[i];
+					auto& z1i = z1[i];
+					auto& z2i = z2[i];
+					const auto yL = c.b0 * xL + z1i[ch];
+					const auto yR = c.b0 * xR + z1i[ch + 1];
+					z1i[ch] = c.b1 * xL - c.a1 * yL + z2i[ch];
+					z1i[ch + 1] = c.b1 * xR - c.a1 * yR + z2i[ch + 1];
+					z2i[ch] = c.b2 * xL - c.a2 * yL;
+					z2i[ch + 1] = c.b2 * xR - c.a2 * yR;
+					xL = yL;
+					xR = yR;
+				}
+				l[s] = xL;
+				r[s] = xR;
+			}
+		}
+	};
+
 	template<typename Float>
 	struct LowkeyChebyshevFilter
 	{
+		/* 4-pole chebyshev lowpass (fc = .45, .5% ripple) factored into two sections */
 		LowkeyChebyshevFilter() :
-			filters()
+			filter()
 		{
-			for (auto& filter : filters)
-				filter.makeChebyshev_lp_4pole_fc45_ripl5();
+			const auto g = static_cast<Float>(0.7932019288932675); // sqrt(6.291693e-01)
+			const auto g2 = g * static_cast<Float>(2);
+			filter.setCoefs
+			({
+				BiquadCoefs<Float>{ g, g2, g, static_cast<Float>(1.749751122591714), static_cast<Float>(0.8485141950809589) },
+				BiquadCoefs<Float>{ g, g2, g, static_cast<Float>(1.3273108774082807), static_cast<Float>(0.47034510714569555) }
+			});
 		}
 		
 		int getLatency() const noexcept
@@ -241,16 +411,15 @@ namespace oversampling
 		
 		void processBlock(Float* const* audioBuffer, int numChannels, const int numSamples) noexcept
 		{
-			for (auto ch = 0; ch < numChannels; ++ch)
-				filters[ch].processBlock(audioBuffer[ch], numSamples);
+			filter.processBlock(audioBuffer, numChannels, numSamples);
 		}
 		
 		float processSample(Float sample, int ch) noexcept
 		{
-			return filters[ch].processSample(sample);
+			return filter.processSample(sample, ch);
 		}
 		
 	protected:
-		std::array<IIR<Float>, 4> filters;
+		BiquadCascade<Float, 2> filter;
 	};
 }
\ No newline at end of file
@@ -1,20 +1,126 @@
 #pragma once
 #include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
 #include "juce_audio_basics/juce_audio_basics.h"
 #include "Filter.h"
 #include "ConvolutionFilter.h"
 #include "IIRFilter.h"
+#include "HalfbandFilter.h"
+#include "AllpassHalfband.h"
+#include "../Interpolation.h"
 
 namespace oversampling
 {
-	constexpr size_t MaxNumStages = 2;
+	constexpr size_t MaxNumStages = 3;
 	static constexpr size_t MaxOrder = 1 << MaxNumStages;
+	static constexpr int LegacyOrder = 4;
 	static constexpr int NumChannels = 2;
 	
 	using String = juce::String;
 	using AudioBufferF = juce::AudioBuffer<float>;
 	using AudioBufferD = juce::AudioBuffer<double>;
 
+	enum class FilterType
+	{
+		IIRConvolution, // 4-pole chebyshev (2x) + sinc convolution (4x)
+		Polyphase, // polyphase halfband FIR, linear phase
+		PolyphaseAllpass, // polyphase halfband IIR (allpass), low latency
+		IIRConvolutionMinPhase, // like IIRConvolution, but with minimum phase sinc kernels
+		NumFilterTypes
+	};
+
+	inline String toString(FilterType t)
+	{
+		switch (t)
+		{
+		case FilterType::IIRConvolution: return "iir convolution";
+		case FilterType::Polyphase: return "polyphase";
+		case FilterType::PolyphaseAllpass: return "polyphase allpass";
+		case FilterType::IIRConvolutionMinPhase: return "iir convolution min phase";
+		default: return "";
+		}
+	}
+
+	/* the legacy chain: chebyshev 2x stage + sinc convolution 4x stage */
+	inline bool isConvolution(FilterType t) noexcept
+	{
+		return t == FilterType::IIRConvolution || t == FilterType::IIRConvolutionMinPhase;
+	}
+
+	/* stopband attenuation of the halfband stages, their length and kaiser window follow from it */
+	static constexpr double HalfbandAttenuationDb = 90.;
+	/* stopband attenuation of the allpass halfband stages */
+	static constexpr double AllpassAttenuationDb = 90.;
+	/* upper edge of the passband of the first stage, which must stay clean of aliases */
+	static constexpr double PassbandHz = 20000.;
+	/* the auto factor picks the lowest order that lifts Fs to at least this rate */
+	static constexpr double MinSampleRateUp = 176000.;
+
+	/* narrowest transition band, so rates below 44.1khz shrink the passband instead of growing the kernels endlessly */
+	static constexpr double MinTransition = .04;
+
+	/*
+	* Fs (base rate), stage. transition band of a halfband stage normalised to its higher rate.
+	* the images of the passband start at the stage's lower rate minus the passband
+	*/
+	inline double getHalfbandTransition(double Fs, int stage) noexcept
+	{
+		const auto FsHigh = Fs * static_cast<double>(2 << stage);
+		return std::max(.5 - 2. * PassbandHz / FsHigh, MinTransition);
+	}
+
+	/* Fs (base rate), stage. the allpass halfbands reject the same transition band as the fir ones */
+	inline double getAllpassTransition(double Fs, int stage) noexcept
+	{
+		return getHalfbandTransition(Fs, stage);
+	}
+
+	/* Fs (base rate) */
+	inline int getAutoOrder(double Fs) noexcept
+	{
+		auto order = 1;
+		while (Fs * static_cast<double>(order) < MinSampleRateUp && order < static_cast<int>(MaxOrder))
+			order *= 2;
+		return order;
+	}
+
+	enum class Factor
+	{
+		Auto, x2, x4, x8,
+		FIR4, // the legacy 4x convolution chain
+		NumFactors
+	};
+
+	inline String toString(Factor f)
+	{
+		switch (f)
+		{
+		case Factor::Auto: return "auto";
+		case Factor::x2: return "2x";
+		case Factor::x4: return "4x";
+		case Factor::x8: return "8x";
+		case Factor::FIR4: return "4x fir";
+		default: return "";
+		}
+	}
+
+	/* Fs (base rate), factor */
+	inline int getOrder(double Fs, Factor f) noexcept
+	{
+		switch (f)
+		{
+		case Factor::x2: return 2;
+		case Factor::x4: return 4;
+		case Factor::x8: return 8;
+		case Factor::FIR4: return LegacyOrder;
+		default: return getAutoOrder(Fs);
+		}
+	}
+
 	template<typename Float>
 	inline void zeroStuff(Float* const* samplesDest, const Float* const* samplesSrc,
 		int numChannels, int numSamples) noexcept
@@ -66,86 +172,296 @@ namespace oversampling
 				samplesDest[ch][s] = samplesSrc[ch][s * 2];
 	}
 
+	/*
+	* upsamples control signals (modulators, depth), so they can be rendered at the base rate
+	* and still drive the oversampled delay. slow signals are interpolated linearly. the images of linear
+	* interpolation would turn audio rate modulators into fm sidebands above the base rate's nyquist,
+	* so those are interpolated with a windowed sinc instead. both read Latency samples behind the input,
+	* so switching between them doesn't jump.
+	*/
+	struct ControlUpsampler
+	{
+		static constexpr int MaxNumChannels = 4;
+		using Sinc = interpolation::PolyphaseTable<double, 16>;
+		static constexpr int Latency = Sinc::Ahead;
+		static constexpr int History = Sinc::Behind + Sinc::Ahead + 1;
+
+		ControlUpsampler() :
+			buffer(),
+			order(1)
+		{
+		}
+
+		/* order, blockSize (base rate), startVal */
+		void prepare(int _order, int blockSize, double startVal = 0.)
+		{
+			order = _order;
+			for (auto& b : buffer)
+				b.assign(History + blockSize, startVal);
+		}
+
+		/* dest (numSamples * order), src, numChannels, numSamples (base rate), bandLimited */
+		void operator()(double* const* dest, const double* const* src, int numChannels, int numSamples, bool bandLimited) noexcept
+		{
+			const auto orderInv = 1. / static_cast<double>(order);
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto& b = buffer[ch];
+				// the last History samples of the previous block, then this block
+				auto x = b.data();
+				std::copy(src[ch], src[ch] + numSamples, x + History);
+				auto d = dest[ch];
+				// reads from Latency samples before the first new one up to the last one Latency samples ago
+				const auto start = static_cast<double>(History - Latency - 1);
+				if (bandLimited)
+				{
+					const auto& sinc = interpolation::sinc16<double>;
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						const auto sUp = s * order;
+						for (auto i = 0; i < order; ++i)
+							d[sUp + i] = sinc(x, start + static_cast<double>(s) + static_cast<double>(i + 1) * orderInv);
+					}
+				}
+				else
+				{
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						const auto x0 = x[History - Latency - 1 + s];
+						const auto inc = (x[History - Latency + s] - x0) * orderInv;
+						const auto sUp = s * order;
+						for (auto i = 0; i < order; ++i)
+							d[sUp + i] = x0 + static_cast<double>(i + 1) * inc;
+					}
+				}
+				std::copy(x + numSamples, x + numSamples + History, x);
+			}
+		}
+
+		int getOrder() const noexcept
+		{
+			return order;
+		}
+
+	protected:
+		std::array<std::vector<double>, MaxNumChannels> buffer;
+		int order;
+	};
+
+	/* the filter kernels of one (Fs, order) configuration */
+	template<typename Float>
+	struct Design
+	{
+		/* Fs (base rate), order */
+		Design(double Fs, int order) :
+			halfbands(),
+			allpasses(),
+			irUp(),
+			irDown(),
+			irUpMinPhase(),
+			irDownMinPhase()
+		{
+			for (auto st = 0; st < MaxNumStages; ++st)
+				if ((1 << st) < order)
+				{
+					halfbands[st] = makeHalfbandKernel<Float>(HalfbandAttenuationDb, getHalfbandTransition(Fs, st));
+					allpasses[st] = AllpassHalfbandKernel<Float>(static_cast<Float>(AllpassAttenuationDb), static_cast<Float>(getAllpassTransition(Fs, st)));
+				}
+
+			if (order == LegacyOrder)
+			{
+				const auto FsUp = static_cast<Float>(Fs * static_cast<double>(LegacyOrder));
+				const auto fc = static_cast<Float>(Fs * .5);
+				const auto bw = static_cast<Float>(Fs);
+				irUp = makeSincFilter2(FsUp, fc, bw, true);
+				irDown = makeSincFilter2(FsUp, fc, bw, false);
+				irUpMinPhase = makeMinimumPhase(irUp);
+				irDownMinPhase = makeMinimumPhase(irDown);
+			}
+		}
+
+		std::array<HalfbandKernel<Float>, MaxNumStages> halfbands;
+		std::array<AllpassHalfbandKernel<Float>, MaxNumStages> allpasses;
+		/* sinc kernels of the legacy 4x stage (IIRConvolution only) */
+		ImpulseResponse<Float> irUp, irDown, irUpMinPhase, irDownMinPhase;
+	};
+
+	template<typename Float>
+	using DesignPtr = std::shared_ptr<const Design<Float>>;
+
+	/*
+	* designs are memoised by (Fs, order),
+	* so switching the factor or instantiating the plugin many times doesn't redo the sinc/window math.
+	* only called from prepareToPlay, so the lock never touches the audio thread.
+	* every sample type has its own cache.
+	*/
+	template<typename Float>
+	inline DesignPtr<Float> getDesign(double Fs, int order)
+	{
+		static std::mutex mutex;
+		static std::map<std::pair<double, int>, DesignPtr<Float>> designs;
+
+		const std::lock_guard<std::mutex> lock(mutex);
+		const auto key = std::make_pair(Fs, order);
+		auto it = designs.find(key);
+		if (it != designs.end())
+			return it->second;
+		auto design = std::make_shared<const Design<Float>>(Fs, order);
+		designs[key] = design;
+		return design;
+	}
+
+	template<typename Float>
 	struct Processor
 	{
+		using AudioBuffer = juce::AudioBuffer<Float>;
+		using Halfbands = std::array<HalfbandFilter<Float>, MaxNumStages>;
+		using Allpasses = std::array<AllpassHalfbandFilter<Float>, MaxNumStages>;
+
 		Processor() :
 			buffer(),
+			design(),
 			//
-			filterUp4(176400., 22050., 44100., true), //  17 samples
-			filterDown4(176400., 22050., 44100.),
+			filterUp4(),
+			filterDown4(),
 			filterUp2(),
 			filterDown2(),
 			//
+			halfbands(),
+			allpasses(),
+			padDelay(),
+			//
 			FsUp(0.),
 			blockSizeUp(0),
 			//
-			numSamples1x(0), numSamples2x(0), numSamples4x(0),
-			enabled(true)
+			numSamples1x(0), numSamples2x(0), numSamplesUp(0),
+			numStages(0), order(1),
+			filterType(FilterType::Polyphase),
+			enabled(false)
 		{
 		}
 
 		Processor(Processor& p) :
 			buffer(p.buffer),
-			filterUp2(p.filterUp2), filterUp4(p.filterUp4),
-			filterDown4(p.filterDown4), filterDown2(p.filterDown2),
+			design(p.design),
+			filterUp4(p.filterUp4), filterDown4(p.filterDown4),
+			filterUp2(p.filterUp2), filterDown2(p.filterDown2),
+			halfbands(p.halfbands), allpasses(p.allpasses), padDelay(p.padDelay),
 			FsUp(p.FsUp), blockSizeUp(p.blockSizeUp),
-			numSamples1x(0), numSamples2x(0), numSamples4x(0),
+			numSamples1x(0), numSamples2x(0), numSamplesUp(0),
+			numStages(p.numStages), order(p.order),
+			filterType(p.filterType),
 			enabled(p.enabled)
 		{
 		}
 
-		void prepareToPlay(const double Fs, const int blockSize, bool _enabled)
+		/* Fs, blockSize, order (1, 2, 4 or 8; 1 disables oversampling), filterType */
+		void prepareToPlay(const double Fs, const int blockSize, int _order,
+			FilterType _filterType = FilterType::Polyphase)
 		{
-			enabled = _enabled;
-			if (enabled)
+			filterType = _filterType;
+			// the legacy chain is a fixed 4x design
+			if (isConvolution(filterType) && _order != 1)
+				_order = LegacyOrder;
+
+			numStages = 0;
+			while ((1 << (numStages + 1)) <= _order && numStages < static_cast<int>(MaxNumStages))
+				++numStages;
+			order = 1 << numStages;
+			enabled = order != 1;
+
+			FsUp = Fs * static_cast<double>(order);
+			blockSizeUp = blockSize * order;
+			buffer.setSize(4, blockSizeUp, false, false, false);
+
+			if (!enabled)
+				return;
+
+			design = getDesign<Float>(Fs, order);
+
+			if (filterType == FilterType::Polyphase)
+			{
+				for (auto st = 0; st < numStages; ++st)
+					halfbands[st].prepare(design->halfbands[st], blockSize << st);
+				padDelay.setDelay(getPolyphasePadding());
+			}
+			else if (filterType == FilterType::PolyphaseAllpass)
 			{
-				FsUp = Fs * static_cast<double>(MaxOrder);
-				blockSizeUp = blockSize * MaxOrder;
+				for (auto st = 0; st < numStages; ++st)
+					allpasses[st].prepare(design->allpasses[st], blockSize << st);
+			}
+			else if (filterType == FilterType::IIRConvolutionMinPhase)
+			{
+				filterUp4.prepare(design->irUpMinPhase, true);
+				filterDown4.prepare(design->irDownMinPhase, false);
 			}
 			else
 			{
-				FsUp = Fs;
-				blockSizeUp = blockSize;
+				filterUp4.prepare(design->irUp, true);
+				filterDown4.prepare(design->irDown, false);
 			}
-			buffer.setSize(4, blockSizeUp, false, false, false);
 		}
 		
 		////////////////////////////////////////
-		AudioBufferD& upsample(AudioBufferD& input) noexcept
+		AudioBuffer& upsample(AudioBuffer& input) noexcept
 		{
 			if (enabled)
 			{
 				const auto numChannels = input.getNumChannels();
 				numSamples1x = input.getNumSamples();
 				numSamples2x = numSamples1x * 2;
-				numSamples4x = numSamples1x * 4;
+				numSamplesUp = numSamples1x * order;
 
-				buffer.setSize(numChannels, numSamples4x, true, false, true);
+				buffer.setSize(numChannels, numSamplesUp, true, false, true);
 				const auto samplesIn = input.getArrayOfReadPointers();
 				auto samplesUp = buffer.getArrayOfWritePointers();
 				
+				if (filterType == FilterType::Polyphase)
+				{
+					upsampleStages(halfbands, samplesUp, samplesIn, numChannels);
+					return buffer;
+				}
+				if (filterType == FilterType::PolyphaseAllpass)
+				{
+					upsampleStages(allpasses, samplesUp, samplesIn, numChannels);
+					return buffer;
+				}
+
 				// 2x
 				zeroStuff(samplesUp, samplesIn, numChannels, numSamples1x);
 				filterUp2.processBlock(samplesUp, numChannels, numSamples2x);
 				// 4x
 				zeroStuff(samplesUp, numChannels, numSamples2x);
-				filterUp4.processBlockUp(samplesUp, numChannels, numSamples4x);
+				filterUp4.processBlockUp(samplesUp, numChannels, numSamplesUp);
 
 				for(auto ch = 0; ch < numChannels; ++ch)
-					juce::FloatVectorOperations::multiply(samplesUp[ch], 2., numSamples4x);
+					juce::FloatVectorOperations::multiply(samplesUp[ch], static_cast<Float>(2), numSamplesUp);
 				
 				return buffer;
 			}
 			return input;
 		}
 		
-		void downsample(AudioBufferD& outBuf) noexcept
+		void downsample(AudioBuffer& outBuf) noexcept
 		{
 			auto samplesUp = buffer.getArrayOfWritePointers();
 			auto samplesOut = outBuf.getArrayOfWritePointers();
 			const auto numChannels = outBuf.getNumChannels();
+
+			if (filterType == FilterType::Polyphase)
+			{
+				padDelay(samplesUp, numChannels, numSamplesUp);
+				downsampleStages(halfbands, samplesOut, samplesUp, numChannels);
+				return;
+			}
+			if (filterType == FilterType::PolyphaseAllpass)
+			{
+				downsampleStages(allpasses, samplesOut, samplesUp, numChannels);
+				return;
+			}
+
 			// 4x
-			filterDown4.processBlockDown(samplesUp, numChannels, numSamples4x);
+			filterDown4.processBlockDown(samplesUp, numChannels, numSamplesUp);
 			decimate(samplesUp, numChannels, numSamples2x);
 			// 2x
 			filterDown2.processBlock(samplesUp, numChannels, numSamples2x);
@@ -167,76 +483,141 @@ namespace oversampling
 		{
 			return enabled;
 		}
+
+		int getOrder() const noexcept
+		{
+			return order;
+		}
+
+		FilterType getFilterType() const noexcept
+		{
+			return filterType;
+		}
 		
 		int getLatency() const noexcept
 		{
-			const auto mult = enabled ? 1 : 0;
-			return mult * (filterUp2.getLatency() + filterDown2.getLatency() + filterUp4.getLatency() + filterDown4.getLatency());
+			if (!enabled)
+				return 0;
+			if (filterType == FilterType::Polyphase)
+				return (getPolyphaseLatencyUp() + padDelay.getLatency()) / order;
+			if (filterType == FilterType::PolyphaseAllpass)
+				return static_cast<int>(std::round(getAllpassGroupDelayUp() / static_cast<double>(order)));
+			return static_cast<int>(std::round(static_cast<double>(getConvolutionLatencyUp()) / static_cast<double>(order)));
 		}
 		
 	protected:
-		AudioBufferD buffer;
+		AudioBuffer buffer;
+		DesignPtr<Float> design;
 
-		ConvolutionFilter<double> filterUp4, filterDown4;
-		LowkeyChebyshevFilter<double> filterUp2, filterDown2;
+		ConvolutionFilter<Float> filterUp4, filterDown4;
+		LowkeyChebyshevFilter<Float> filterUp2, filterDown2;
+		Halfbands halfbands;
+		Allpasses allpasses;
+		PadDelay<Float, MaxOrder> padDelay;
 
 		double FsUp;
 		int blockSizeUp;
 
-		int numSamples1x, numSamples2x, numSamples4x;
+		int numSamples1x, numSamples2x, numSamplesUp, numStages, order;
+		FilterType filterType;
 		bool enabled;
+
+		/* latency of all halfband stages in samples of the highest rate */
+		int getPolyphaseLatencyUp() const noexcept
+		{
+			auto latency = 0;
+			for (auto st = 0; st < numStages; ++st)
+				latency += halfbands[st].getLatency() * (order >> (st + 1));
+			return latency;
+		}
+
+		/* latency of the legacy chain in samples of the highest rate */
+		int getConvolutionLatencyUp() const noexcept
+		{
+			// the chebyshev stages run at 2x, the sinc convolution at 4x
+			const auto latency2x = filterUp2.getLatency() + filterDown2.getLatency();
+			return latency2x * (order / 2) + filterUp4.getLatency() + filterDown4.getLatency();
+		}
+
+		/* delay in samples of the highest rate that makes the latency a whole number of base rate samples */
+		int getPolyphasePadding() const noexcept
+		{
+			return (order - getPolyphaseLatencyUp() % order) % order;
+		}
+
+		/* group delay at dc of all allpass stages in samples of the highest rate. not padded, it's low latency after all */
+		double getAllpassGroupDelayUp() const noexcept
+		{
+			auto groupDelay = 0.;
+			for (auto st = 0; st < numStages; ++st)
+				groupDelay += allpasses[st].getGroupDelay() * static_cast<double>(order >> (st + 1));
+			return groupDelay;
+		}
+
+		template<class Stages>
+		void upsampleStages(Stages& stages, Float* const* samplesUp, const Float* const* samplesIn, int numChannels) noexcept
+		{
+			stages[0].processBlockUp(samplesUp, samplesIn, numChannels, numSamples1x);
+			for (auto st = 1; st < numStages; ++st)
+				stages[st].processBlockUp(samplesUp, samplesUp, numChannels, numSamples1x << st);
+		}
+
+		template<class Stages>
+		void downsampleStages(Stages& stages, Float* const* samplesOut, Float* const* samplesUp, int numChannels) noexcept
+		{
+			for (auto st = numStages - 1; st > 0; --st)
+				stages[st].processBlockDown(samplesUp, samplesUp, numChannels, numSamples1x << st);
+			stages[0].processBlockDown(samplesOut, samplesUp, numChannels, numSamples1x);
+		}
 	};
 
+	template<typename Float>
 	struct OversamplerWithShelf
 	{
+		using AudioBuffer = juce::AudioBuffer<Float>;
+
 		OversamplerWithShelf() :
-			filters(),
-			coefficients(),
+			shelf(),
 			cutoff(1.),
 			q(1.),
 			gain(0.)
 		{}
 
-		void prepareToPlay(double sampleRate, const int _blockSize, bool enabled)
+		/* sampleRate, blockSize, order (1 disables oversampling), filterType */
+		void prepareToPlay(double sampleRate, const int _blockSize, int order,
+			FilterType filterType = FilterType::Polyphase)
 		{
-			processor.prepareToPlay(sampleRate, _blockSize, enabled);
-
-			juce::dsp::ProcessSpec spec;
-			spec.sampleRate = sampleRate;
-			spec.maximumBlockSize = _blockSize;
-			spec.numChannels = 2;
+			processor.prepareToPlay(sampleRate, _blockSize, order, filterType);
 
 			cutoff = 20000.;
 			gain = juce::Decibels::decibelsToGain(14.436 * .5);
 			q = .229;
-			coefficients = juce::dsp::IIR::Coefficients<double>::makeHighShelf(sampleRate, cutoff, q, gain);
-
-			for (auto& filter : filters)
+			const auto coefficients = juce::dsp::IIR::Coefficients<double>::makeHighShelf(sampleRate, cutoff, q, gain);
+			// juce stores b0, b1, b2, a1, a2 normalised by a0
+			const auto c = coefficients->coefficients.begin();
+			shelf.setCoefs({ BiquadCoefs<Float>
 			{
-				filter.reset();
-				filter.prepare(spec);
-				filter.coefficients = coefficients;
-			}
+				static_cast<Float>(c[0]), static_cast<Float>(c[1]), static_cast<Float>(c[2]),
+				static_cast<Float>(c[3]), static_cast<Float>(c[4])
+			} });
+			shelf.reset();
 		}
 		
 		/* processing methods */
-		AudioBufferD& upsample(AudioBufferD& input) noexcept
+		AudioBuffer& upsample(AudioBuffer& input) noexcept
 		{
 			return processor.upsample(input);
 		}
 		
-		void downsample(AudioBufferD& outBuf) noexcept
+		void downsample(AudioBuffer& outBuf) noexcept
 		{
 			processor.downsample(outBuf);
+
+			// the shelf compensates the passband droop of the chebyshev stage only
+			if (!isConvolution(processor.getFilterType()))
+				return;
 			
-			for (auto ch = 0; ch < outBuf.getNumChannels(); ++ch)
-			{
-				auto& filter = filters[ch];
-				double* samples[] = { outBuf.getWritePointer(ch) };
-				juce::dsp::AudioBlock<double> block(samples, 1, outBuf.getNumSamples());
-				juce::dsp::ProcessContextReplacing<double> context(block);
-				filter.process(context);
-			}
+			shelf.processBlock(outBuf.getArrayOfWritePointers(), outBuf.getNumChannels(), outBuf.getNumSamples());
 		}
 		
 		////////////////////////////////////////
@@ -244,27 +625,22 @@ namespace oversampling
 		const int getBlockSizeUp() const noexcept { return processor.getBlockSizeUp(); }
 		
 		bool isEnabled() const noexcept { return processor.isEnabled(); }
+		int getOrder() const noexcept { return processor.getOrder(); }
+		FilterType getFilterType() const noexcept { return processor.getFilterType(); }
 		
 		int getLatency() const noexcept
 		{
 			return processor.getLatency();
 		}
 		
-		Processor processor;
-		std::array<juce::dsp::IIR::Filter<double>, 4> filters;
-		juce::ReferenceCountedObjectPtr<juce::dsp::IIR::Coefficients<double>> coefficients;
+		Processor<Float> processor;
+		BiquadCascade<Float, 1> shelf;
 		double cutoff, q, gain;
 	};
 }
 
 /*
 try other filter types:
-	polyphase IIR
-	Halfband-Polyphase IIR
 	butterworth low pass filter
-automatic reaction to different sampleRates
-
-optimisations:
-convolution filter simd
 
 */
\ No newline at end of file